@@ -0,0 +1,107 @@
+#d
+  a:a  col1
+  !:!  col2
+  ":"  col3
+  $:$  col4
+  %:%  col5
+  &:&  col6
+  ':'  col7
+  (:(  col8
+  ):)  col9
+  *:*  col10
+  +:+  col11
+  ,:,  col12
+  -:-  col13
+  /:/  col14
+  ;:;  col15
+  <:<  col16
+  =:=  col17
+  >:>  col18
+  ?:?  col19
+  @:@  col20
+  A:A  col21
+  B:B  col22
+  C:C  col23
+  D:D  col24
+  E:E  col25
+  F:F  col26
+  G:G  col27
+  H:H  col28
+  I:I  col29
+  J:J  col30
+  K:K  col31
+  L:L  col32
+  M:M  col33
+  N:N  col34
+  O:O  col35
+  P:P  col36
+  Q:Q  col37
+  R:R  col38
+  S:S  col39
+  T:T  col40
+  U:U  col41
+  V:V  col42
+  W:W  col43
+  X:X  col44
+  Y:Y  col45
+  Z:Z  col46
+  [:[  col47
+  \:\  col48
+  ]:]  col49
+  ^:^  col50
+  _:_  col51
+  `:`  col52
+  b:b  col53
+  c:c  col54
+  d:d  col55
+  e:e  col56
+  f:f  col57
+  g:g  col58
+  h:h  col59
+  i:i  col60
+  j:j  col61
+  k:k  col62
+  l:l  col63
+  m:m  col64
+:
+1a 1a 6a 5a
+5a 1a 3a 5a 1a
+2a 3a 1a 1a 3a
+1a 1a 1a 2a 3a 3a
+3a 2a 1a 1a 1a 2a
+5a 2a 6a
+2a 8a
+3a 1a 2a 2a 1a
+1a 4a 2a 3a 3a
+1a 2a 1a 3a 2a
+2a 3a 1a 3a
+2a 2a 4a 1a 2a
+3a 2a 2a
+3a 3a 5a 2a
+1a 1a 4a 2a 1a
+1a 2a 4a 1a 1a
+3a 2a 1a 2a 3a
+3a 1a 1a 3a 3a
+3a 2a 1a 1a 2a
+1a 2a 1a 2a 3a 1a 2a
+:
+6a 3a 1a 1a 1a 1a
+2a 2a 1a 1a 1a
+2a 3a 1a 1a 2a 2a
+1a 1a 4a 2a
+1a 1a 1a 1a 4a 2a
+3a 2a 2a 1a
+1a 1a 1a 1a 8a
+1a 4a 3a 1a 2a
+3a 2a 1a 5a 4a
+3a 1a 5a
+2a 1a 2a 5a
+1a 5a 2a 1a 3a 1a
+2a 1a 3a 1a 2a 1a 1a
+1a 6a 2a 3a
+2a 2a 1a 1a 3a 1a
+2a 3a 1a 1a 2a 4a
+4a 2a 1a 1a 1a
+1a 2a 1a 1a 1a 1a 3a
+5a 1a 3a 1a 3a
+1a 1a 3a 1a 1a 1a 1a
@@ -19,30 +19,19 @@
 #include "config.h"
 #include "bitstring.h"
 
-#ifdef LIMITCOLORS
-void fbit_init(int n)
-{
-    if (n > fbit_n)
-    {
-	printf("Number of colors cannot exceed %d\n"
-	    "Recompile with LIMITCOLORS off to remove this limitation\n",
-	    fbit_n);
-	exit(1);
-    }
-}
-#else
-
 int fbit_n;
 int fbit_size;
 
+/* FBIT_INIT - Set up the sizes of the standard bit strings for a puzzle with
+ * n colors.  If they all fit in one int, which they nearly always do, the
+ * fbit_* macros and a few hot loops elsewhere take a faster path.
+ */
+
 void fbit_init(int n)
 {
-    int i;
-
     /* Number of bits in our standard bitstring size */
     fbit_n= n;
 
     /* Number of ints required to store that many bits */
     fbit_size= bit_size(n);
 }
-#endif
@@ -0,0 +1,223 @@
+/* Copyright 2012 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* BITBOARD - For two color grids, we keep a second copy of the grid as bit
+ * masks, so that things that only want to know which cells may be white and
+ * which may be black can look at a whole word of a line at once instead of
+ * one Cell at a time.
+ *
+ * Each row and each column has two masks:  bb_white(k,i) has bit j set if
+ * cell j of line i in direction k may be white, and bb_black(k,i) if it may
+ * be black.  Bits are numbered the same way as in the bit-parallel line
+ * solver, so a line can be copied straight into its masks.  The column masks
+ * are the transpose of the row masks.  Each line gets bb_nword[k] words,
+ * which leaves room for one bit past the end of the line.
+ *
+ * The masks are built from the cells by load_bitboard(), and after that are
+ * kept in step with them by cell_changed(), which every piece of code that
+ * changes a cell after solving has started already calls.  They only
+ * describe one solution, bb_sol, and bb_valid(sol) is false for any other,
+ * or if cells have been changed behind our back, in which case callers
+ * should either call load_bitboard() or look at the cells.
+ */
+
+#include "pbnsolve.h"
+
+int bitboard= 0;		/* Do we keep a bitboard for this puzzle? */
+Solution *bb_sol= NULL;		/* The solution the bitboard describes */
+bit_type *bb_mask[2][2];	/* [color][direction] */
+int bb_nword[2];
+
+#ifdef __GNUC__
+#define bb_ctz(x) __builtin_ctzl(x)
+#define bb_popcount(x) __builtin_popcountl(x)
+#else
+static int bb_ctz(bit_type x)
+{
+    int n= 0;
+    while (!(x & 1)) { x>>= 1; n++; }
+    return n;
+}
+static int bb_popcount(bit_type x)
+{
+    int n= 0;
+    for (; x != 0; x&= x - 1) n++;
+    return n;
+}
+#endif
+
+
+/* INIT_BITBOARD - Allocate the bitboard for a puzzle, if it is a two color
+ * grid.  The masks are not loaded until load_bitboard() is called.
+ */
+
+void init_bitboard(Puzzle *puz)
+{
+    dir_t k;
+    color_t c;
+
+    for (c= 0; c < 2; c++)
+	for (k= 0; k < 2; k++)
+	{
+	    free(bb_mask[c][k]);
+	    bb_mask[c][k]= NULL;
+	}
+    bb_sol= NULL;
+
+    bitboard= (puz->type == PT_GRID && puz->nset == 2 && puz->ncolor == 2);
+    if (!bitboard) return;
+
+    for (k= 0; k < 2; k++)
+    {
+	bb_nword[k]= bit_size((puz->n[1-k] + 1));
+	for (c= 0; c < 2; c++)
+	    bb_mask[c][k]= (bit_type *)
+		malloc(puz->n[k] * bb_nword[k] * sizeof(bit_type));
+    }
+}
+
+
+/* LOAD_BITBOARD - Build the masks for every row and column of the given
+ * solution from its cells.  The columns are built a row at a time, so we
+ * walk the cells in the order they are stored in.
+ */
+
+void load_bitboard(Puzzle *puz, Solution *sol)
+{
+    line_t i, j, nrow= puz->n[D_ROW], ncol= puz->n[D_COL];
+    bit_type *rw, *rb;
+    Cell *cell;
+    dir_t k;
+
+    for (k= 0; k < 2; k++)
+    {
+	memset(bb_mask[0][k], 0, puz->n[k] * bb_nword[k] * sizeof(bit_type));
+	memset(bb_mask[1][k], 0, puz->n[k] * bb_nword[k] * sizeof(bit_type));
+    }
+
+    for (i= 0; i < nrow; i++)
+    {
+	rw= bb_white(D_ROW,i);
+	rb= bb_black(D_ROW,i);
+	for (j= 0, cell= grid_cell(sol,i,0); j < ncol;
+		j++, cell= (Cell *)((char *)cell + sol->cellsize))
+	{
+	    if (may_be_bg(cell))
+	    {
+		rw[_bit_intn(j)]|= _bit_mask(j);
+		bb_white(D_COL,j)[_bit_intn(i)]|= _bit_mask(i);
+	    }
+	    if (may_be(cell, 1))
+	    {
+		rb[_bit_intn(j)]|= _bit_mask(j);
+		bb_black(D_COL,j)[_bit_intn(i)]|= _bit_mask(i);
+	    }
+	}
+    }
+    bb_sol= sol;
+}
+
+
+/* BB_CHANGED - Update the masks for a cell whose value has changed.  'bit' is
+ * the value before the change.  Like cell_changed(), which calls this, it
+ * only toggles the bits that differ, so it may equally well be called before
+ * the change with 'bit' the new value.
+ */
+
+void bb_changed(Cell *cell, bit_type *bit)
+{
+    bit_type d= (bit[0] ^ cell->bit[0]) & 3;
+    line_t r= cell->line[D_ROW], c= cell->line[D_COL];
+
+    if (d & 1)
+    {
+	bb_white(D_ROW,r)[_bit_intn(c)]^= _bit_mask(c);
+	bb_white(D_COL,c)[_bit_intn(r)]^= _bit_mask(r);
+    }
+    if (d & 2)
+    {
+	bb_black(D_ROW,r)[_bit_intn(c)]^= _bit_mask(c);
+	bb_black(D_COL,c)[_bit_intn(r)]^= _bit_mask(r);
+    }
+}
+
+
+/* BB_NEXT_UNSOLVED - Return the index of the first cell at or after j in row
+ * i that is not yet solved, or -1 if there is none.  Bits past the end of
+ * the row are clear, so we never find one there.
+ */
+
+line_t bb_next_unsolved(Solution *sol, line_t i, line_t j)
+{
+    bit_type *w= bb_white(D_ROW,i), *b= bb_black(D_ROW,i);
+    line_t ncol= sol->n[D_COL];
+    int n, nw= bit_size(ncol);
+    bit_type x;
+
+    if (j >= ncol) return -1;
+    n= _bit_intn(j);
+    x= w[n] & b[n] & (_bit_1s << (j % _bit_intsiz));
+    while (x == 0)
+    {
+	if (++n >= nw) return -1;
+	x= w[n] & b[n];
+    }
+    return n * _bit_intsiz + bb_ctz(x);
+}
+
+
+/* BB_COUNT_SOLVED - Return the number of solved cells, counting a word of
+ * each row at a time.  A cell is solved if it may be white or black, but not
+ * both.  Bits past the end of the row are clear in both masks.
+ */
+
+int bb_count_solved(Solution *sol)
+{
+    line_t i, nrow= sol->n[D_ROW], ncol= sol->n[D_COL];
+    bit_type *w, *b;
+    int n, nw= bit_size(ncol), cnt= 0;
+
+    for (i= 0; i < nrow; i++)
+    {
+	w= bb_white(D_ROW,i);
+	b= bb_black(D_ROW,i);
+	for (n= 0; n < nw; n++)
+	    cnt+= bb_popcount(w[n] ^ b[n]);
+    }
+    return cnt;
+}
+
+
+/* BB_ALL_UNKNOWN - Return true if cells lo through hi-1 of line i in
+ * direction k may all be either white or black.
+ */
+
+int bb_all_unknown(dir_t k, line_t i, line_t lo, line_t hi)
+{
+    bit_type *w= bb_white(k,i), *b= bb_black(k,i);
+    bit_type m;
+    int n;
+
+    for (n= _bit_intn(lo); n * _bit_intsiz < hi; n++)
+    {
+	m= _bit_1s;
+	if (n == _bit_intn(lo))
+	    m&= _bit_1s << (lo % _bit_intsiz);
+	if (hi < (n + 1) * _bit_intsiz)
+	    m&= ~(_bit_1s << (hi % _bit_intsiz));
+	if ((w[n] & b[n] & m) != m) return 0;
+    }
+    return 1;
+}
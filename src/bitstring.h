@@ -10,9 +10,11 @@
  * those bits).  I tried caching _bit_intn(N) and _bit_mask(N) in arrays,
  * but that actually made things slower.
  *
- * If the LIMITCOLORS is defined at compile time, then the macros
- * are further optimized under the assumption that all bit strings fit in
- * one long int.
+ * Nearly all puzzles have few enough colors that their bit strings fit in
+ * one long int, so the fbit_* macros test for fbit_size == 1 and handle that
+ * case without a loop.  The test costs almost nothing, since fbit_size never
+ * changes while a puzzle is being solved, and it lets one binary handle
+ * puzzles with any number of colors.
  */
 
 /* bitstring.h - bit string manipulation macros
@@ -67,13 +69,8 @@
 
 /* Fast bit string stuff */
 
-#ifdef LIMITCOLORS
-#define fbit_n _bit_intsiz
-#define fbit_size 1
-#else
 extern int fbit_n;
 extern int fbit_size;
-#endif
 
 /*
  * (macros used internally)
@@ -109,7 +106,7 @@ extern int fbit_size;
 	 * declare (create) Name as a string of N bits
 	 */
 #define	bit_decl(Name, N) \
-	bit_type Name[bit_size(N)]
+	bit_type (Name)[bit_size(N)]
 
 	/*
 	 * declare (reference) Name as a bit string
@@ -120,91 +117,68 @@ extern int fbit_size;
 	/*
 	 * is bit N of string Name set?
 	 */
-#ifdef LIMITCOLORS
-#define bit_test(Name,N) \
-	(*(Name) & _bit_mask(N))
-#else
 #define	bit_test(Name, N) \
 	((Name)[_bit_intn(N)] & _bit_mask(N))
-#endif
 
 	/*
 	 * set bit N of string Name
 	 */
-#ifdef LIMITCOLORS
-#define	bit_set(Name, N) \
-	{ *(Name) |= _bit_mask(N); }
-#else
 #define	bit_set(Name, N) \
 	{ (Name)[_bit_intn(N)] |= _bit_mask(N); }
-#endif
 
 	/*
 	 * clear bit N of string Name
 	 */
-#ifdef LIMITCOLORS
-#define	bit_clear(Name, N) \
-	{ *(Name) &= ~_bit_mask(N); }
-#else
 #define	bit_clear(Name, N) \
 	{ (Name)[_bit_intn(N)] &= ~_bit_mask(N); }
-#endif
 
 	/*
 	 * set all bits in size N string Name
 	 */
 #define	bit_setall(Name, N) \
-	{	register _bit_i; \
+	{	register int _bit_i; \
 		for (_bit_i = bit_size(N)-1; _bit_i >= 0; _bit_i--) \
-			Name[_bit_i]=_bit_1s; \
+			(Name)[_bit_i]=_bit_1s; \
 	}
 
 	/*
 	 * set all bits in string Name
 	 */
-#ifdef LIMITCOLORS
-#define	fbit_setall(Name) \
-	{ *(Name)= _bit_1s; }
-#else
 #define	fbit_setall(Name) \
-	{	register _bit_i; \
-		for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
-			Name[_bit_i]=_bit_1s; \
+	{	register int _bit_i; \
+		if (fbit_size == 1) *(Name)= _bit_1s; \
+		else for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
+			(Name)[_bit_i]=_bit_1s; \
 	}
-#endif
 
 	/*
 	 * clear all bits in size N string Name
 	 */
 #define	bit_clearall(Name, N) \
-	{	register _bit_i; \
+	{	register int _bit_i; \
 		for (_bit_i = bit_size(N)-1; _bit_i >= 0; _bit_i--) \
-			Name[_bit_i]=_bit_0s; \
+			(Name)[_bit_i]=_bit_0s; \
 	}
 
 	/*
 	 * clear all bits in string Name
 	 */
-#ifdef LIMITCOLORS
-#define	fbit_clearall(Name) \
-	{ *(Name)= _bit_0s; }
-#else
 #define	fbit_clearall(Name) \
-	{	register _bit_i; \
-		for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
-			Name[_bit_i]=_bit_0s; \
+	{	register int _bit_i; \
+		if (fbit_size == 1) *(Name)= _bit_0s; \
+		else for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
+			(Name)[_bit_i]=_bit_0s; \
 	}
-#endif
 
 	/*
 	 * Clear all bits in 0...i-1, but leave bits N and later alone
 	 */
 
 #define bit_clearbefore(Name,i) \
-    	{	register _bit_i= bit_size(i)-1; \
-	    	Name[_bit_i]&= ~zeroone((i)%_bit_intsiz); \
+    	{	register int _bit_i= bit_size(i)-1; \
+	    	(Name)[_bit_i]&= ~zeroone((i)%_bit_intsiz); \
 	    	for (_bit_i--; _bit_i >= 0; _bit_i--) \
-	    		Name[_bit_i]=_bit_0s; \
+	    		(Name)[_bit_i]=_bit_0s; \
 	}
 
 	/*
@@ -213,11 +187,11 @@ extern int fbit_size;
 	 */
 
 #define bit_clearafter(Name,i,N) \
-    	{	register _bit_n= bit_size(N); \
-    	 	register _bit_i= bit_size(i)-1; \
-	    	Name[_bit_i]&= zeroone(((i)+1)%_bit_intsiz); \
+    	{	register int _bit_n= bit_size(N); \
+    	 	register int _bit_i= bit_size(i)-1; \
+	    	(Name)[_bit_i]&= zeroone(((i)+1)%_bit_intsiz); \
 	    	for (_bit_i++; _bit_i < _bit_n; _bit_i++) \
-	    		Name[_bit_i]=_bit_0s; \
+	    		(Name)[_bit_i]=_bit_0s; \
 	}
 
 
@@ -225,46 +199,35 @@ extern int fbit_size;
 	 * set bit N of string Name to one, and all others to zero
 	 */
 
-#ifdef LIMITCOLORS
-#define fbit_setonly(Name, N) \
-	{ *(Name)= _bit_mask(N); }
-#else
 #define fbit_setonly(Name, N) \
-	{ fbit_clearall(Name); bit_set(Name, N); }
-#endif
+	{	if (fbit_size == 1) *(Name)= _bit_mask(N); \
+		else { fbit_clearall(Name); bit_set(Name, N); } \
+	}
 
 	/*
 	 * Copy bit string
 	 */
 #define	bit_cpy(Dest, Src, N) \
-	{	register _bit_i; \
+	{	register int _bit_i; \
 		for (_bit_i = bit_size(N)-1; _bit_i >= 0; _bit_i--) \
-			Dest[_bit_i]= Src[_bit_i]; \
+			(Dest)[_bit_i]= (Src)[_bit_i]; \
 	}
 
-#ifdef LIMITCOLORS
 #define	fbit_cpy(Dest, Src) \
-	{ *(Dest)= *(Src); }
-#else
-#define	fbit_cpy(Dest, Src) \
-	{	register _bit_i; \
-		for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
-			Dest[_bit_i]= Src[_bit_i]; \
+	{	register int _bit_i; \
+		if (fbit_size == 1) *(Dest)= *(Src); \
+		else for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
+			(Dest)[_bit_i]= (Src)[_bit_i]; \
 	}
-#endif
 
 	/*
 	 * OR the source bit string into the destination
 	 */
-#ifdef LIMITCOLORS
 #define	fbit_or(Dest, Src) \
-	{ *(Dest)|= *(Src); }
-#else
-#define	fbit_or(Dest, Src) \
-	{	register _bit_i; \
-		for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
-			Dest[_bit_i]|= Src[_bit_i]; \
+	{	register int _bit_i; \
+		if (fbit_size == 1) *(Dest)|= *(Src); \
+		else for (_bit_i = fbit_size-1; _bit_i >= 0; _bit_i--) \
+			(Dest)[_bit_i]|= (Src)[_bit_i]; \
 	}
-#endif
 
 #endif
@@ -106,6 +106,80 @@ void make_clues(Puzzle *puz, Solution *sol)
 }
 
 
+/* PACK_CLUES - Move the arrays of all the clues into one block, and carve
+ * out the arrays the line solvers keep for each clue from the same block.
+ * The arrays for each clue are kept together, so touching a line brings in
+ * a few cache lines instead of one for each array, and the whole lot can be
+ * freed at once.  This is called once the puzzle is loaded, after which
+ * clues can no longer be appended to.
+ */
+
+void pack_clues(Puzzle *puz)
+{
+    dir_t k;
+    line_t i, j, n;
+    Clue *clue;
+    line_t *p;
+    size_t size= 0;
+
+    /* Size of the block, in line_t's.  Each clue gets length, color (padded
+     * out to a whole line_t), lpos, rpos, lcov, rcov, colorcnt, and lbcl
+     * and rbcl if it has any blots.  lpos and rpos are -1 terminated. */
+    for (k= 0; k < puz->nset; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    n= clue->n;
+	    size+= 5*n + 2 + (sizeof(line_t) - 1 + n * sizeof(color_t)) /
+		    sizeof(line_t) + puz->ncolor;
+	    for (j= 0; j < n; j++)
+		if (clue->length[j] == 0)
+		{
+		    size+= 2*n;
+		    break;
+		}
+	}
+
+    puz->clueblock= p= (line_t *)malloc(size * sizeof(line_t));
+
+    for (k= 0; k < puz->nset; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    n= clue->n;
+
+	    memcpy(p, clue->length, n * sizeof(line_t));
+	    free(clue->length);
+	    clue->length= p; p+= n;
+
+	    memcpy(p, clue->color, n * sizeof(color_t));
+	    free(clue->color);
+	    clue->color= (color_t *)p;
+	    p+= (sizeof(line_t) - 1 + n * sizeof(color_t)) / sizeof(line_t);
+	    clue->s= n;
+
+	    clue->lpos= p; p+= n + 1;
+	    clue->rpos= p; p+= n + 1;
+	    clue->lcov= p; p+= n;
+	    clue->rcov= p; p+= n;
+
+	    clue->lbcl= clue->rbcl= NULL;
+	    for (j= 0; j < n; j++)
+		if (clue->length[j] == 0)
+		{
+		    clue->lbcl= p; p+= n;
+		    clue->rbcl= p; p+= n;
+		    break;
+		}
+
+	    clue->colorcnt= p; p+= puz->ncolor;
+
+	    /* Built later by init_check(), if we need it */
+	    clue->nfa= NULL;
+	}
+}
+
+
 /* CLUE_INIT - Do some generic initialization to the Clue data structures.
  *
  *  (1) Store line lengths in every clue.
@@ -141,9 +215,9 @@ void clue_init(Puzzle *puz, Solution *sol)
 		    ;
 	    }
 
-	    /* Create color count array, if we are using it */
+	    /* Clear color count array, if we are using it */
 	    if (count_colors)
-		clue->colorcnt= (line_t *)calloc(puz->ncolor, sizeof(line_t));
+		memset(clue->colorcnt, 0, puz->ncolor * sizeof(line_t));
 
 	    /* Compute slack */
 	    fill= 0;
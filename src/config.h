@@ -37,6 +37,58 @@
 #define SPRINT_LENGTH 4000
 #define PLOD_LENGTH 40
 
+/* LINE TABLE - On two color puzzles, lines no longer than LINETABLE_MAX
+ * cells are solved by table lookup instead of by the line solver.  Each
+ * distinct clue gets a table with one entry for every possible state of the
+ * line, filled in the first time that state is seen, so a table takes
+ * 4*3^LINETABLE_MAX bytes.  It can be no larger than 15.
+ */
+
+#define LINETABLE_MAX 10
+
+/* LINE CACHE SIZE - The line cache tables are kept within a memory budget.
+ * This can be set in megabytes with the -k option.  Otherwise, it is enough
+ * for CACHE_PERLINE entries for each row and column of the puzzle, but no
+ * more than CACHE_MB_MAX megabytes.  Tables start out with room for about
+ * CACHE_STARTLINE entries per line, and grow as needed until they reach the
+ * budget, but are never smaller than CACHE_MINSLOTS slots.  Tables always
+ * double in size, so one may stop growing at anything over half its budget.
+ */
+
+#define CACHE_PERLINE 8192
+#define CACHE_MB_MAX 256
+#define CACHE_STARTLINE 64
+#define CACHE_MINSLOTS 1000
+
+/* LINE CACHE BYPASS - Lookups of each line in the line cache are sampled in
+ * groups of CACHE_SAMPLE.  If fewer than CACHE_MINHITS of a sample are hits,
+ * the line doesn't use the cache at all for the next CACHE_BYPASS times it
+ * is solved, and then another sample is taken.
+ */
+
+#define CACHE_SAMPLE 32
+#define CACHE_MINHITS 2
+#define CACHE_BYPASS 128
+
+/* LINE STORE - The persistent line store (-p) is created with STORE_SLOTS
+ * slots, each with room for lines whose compressed state is no more than
+ * STORE_STATEWORDS words long, which is a line of 128 cells in a two color
+ * puzzle.  Each entry can be in any of STORE_PROBES consecutive slots.  The
+ * file is only given disk space as slots are used.
+ */
+
+#define STORE_SLOTS 1048576
+#define STORE_STATEWORDS 4
+#define STORE_PROBES 8
+
+/* FEASIBILITY CACHE - The cache of line_feasible() results used by -aC and
+ * -aE has FEAS_CELLSLOTS entries for each cell of the puzzle, but no more
+ * than FEAS_SLOTS, rounded up to a power of two.
+ */
+
+#define FEAS_CELLSLOTS 8
+#define FEAS_SLOTS 65536
+
 /* DUMP FILE - IF DUMP_FILE is defined, a copy of the input is dumped to that
  * file before starting.  Mostly useful for debugging CGI versions of the
  * program.
@@ -44,14 +96,15 @@
 
 /* #define DUMP_FILE "/tmp/pbnsolve.dump"  /**/
 
-/* LIMIT COLORS - If LIMITCOLORS is defined, pbnsolve will only be able to
- * handle puzzles with 32 colors or less (maybe 64 if your computer has
- * 64 bit long ints).  If this is not defined unlimited colors can be used,
- * at least in theory.  That's never been tested.  The advantage of limiting
- * colors is that it improves performance.
+/* BIG LINES - Row and column numbers, and cell positions within lines, are
+ * normally stored in shorts, so puzzles can be no more than 32767 cells wide
+ * or high.  If BIGLINES is defined, they are stored in ints instead, which
+ * lifts that limit, but makes every cell and clue a bit bigger and the
+ * solver a bit slower.  The number of cells in the puzzle is not limited by
+ * this either way.
  */
 
-#define LIMITCOLORS /**/
+/* #define BIGLINES /**/
 
 /* NO XML - If you don't have libxml2, then you can define NOXML and pbnsolve
  * will be built that can read only the non-xml file formats.  Currently all
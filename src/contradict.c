@@ -38,8 +38,9 @@ line_t cont_line;
 
 int contradict(Puzzle *puz, Solution *sol)
 {
-    line_t i,j, nlast;
-    static line_t n= -1;
+    line_t i,j;
+    int nlast;
+    static int n= -1;
     color_t c;
     Cell *cell;
     int rc;
@@ -49,8 +50,12 @@ int contradict(Puzzle *puz, Solution *sol)
     if (VC)
     	printf("C: **** STARTING CONTRADICTION SEARCH ****\n");
 
+    /* On a new solution, start from the beginning of the spiral */
     if (sol->spiral == NULL)
+    {
     	make_spiral(sol);
+	n= -1;
+    }
 
     /* Point nlast to the last cell we'd process if we were going to proces
      * all cells.  If we've run before, then that is whatever cell we
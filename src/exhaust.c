@@ -84,7 +84,9 @@ void mark_soln(Puzzle *puz, byte *p, line_t *pos, line_t *bcl,
  * more than just the one cell you called it on.  So now we use a scratch
  * pad array to keep track of all the possibilities that we accidentally
  * proved while checking previous cells, so we don't need to check those
- * possibilities again on future cells.
+ * possibilities again on future cells.  The checks are done with
+ * line_feasible(), which is cheaper than left_solve() and also gives us a
+ * solution to mark.
  *
  * If check is false, we assume that everything on the puzzle grid is OK and
  * we do not look for contradictions.  If check is true, we look for
@@ -105,6 +107,7 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
     Hist *h;
     byte *rowpad, **colpad, *pad;
     bit_type *realbit= (bit_type *) malloc(fbit_size * sizeof(bit_type));
+    bit_type *prevbit= (bit_type *) malloc(fbit_size * sizeof(bit_type));
     extern dir_t cont_dir;
     extern line_t cont_line;
 
@@ -143,9 +146,12 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 		if (VE&&VV)
 		    printf("E: Trying (%d,%d)=%d\n", i,j, c);
 
-		/* Temporarily set that cell to the color */
+		/* Temporarily set that cell to the color.  The feasibility
+		 * cache needs to know about it. */
 		cell->n= 1;
+		fbit_cpy(prevbit, cell->bit);
 		fbit_setonly(cell->bit, c);
+		cell_changed(puz, cell, prevbit);
 
 		/* Check all lines that cross the cell */
 		for (k= 0; k < puz->nset; k++)
@@ -166,7 +172,7 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 			dump_line(stdout,puz,sol,k,cell->line[k]);
 		    }
 
-		    if (!left_solve(puz,sol,k,cell->line[k], 0, &pos,&bcl))
+		    if (line_feasible(puz,sol,k,cell->line[k], &pos,&bcl))
 		    {
 		    	/* It worked.  We learned nothing about our cell,
 			 * but the solution we got back includes possible
@@ -231,8 +237,10 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
 	    celldone:;
 
 	    /* Restore the saved bits (possibly changed) to the cell */
+	    fbit_cpy(prevbit, cell->bit);
 	    fbit_cpy(cell->bit, realbit);
 	    cell->n= realn;
+	    cell_changed(puz, cell, prevbit);
 
 	    if (snap) {hintsnapshot(puz,sol); snap= 0;}
 
@@ -246,6 +254,8 @@ int try_everything(Puzzle *puz, Solution *sol, int check)
     for (j= 0; j < puz->n[D_COL]; j++) free(colpad[j]);
     free(colpad);
     free(rowpad);
+    free(realbit);
+    free(prevbit);
 
     exh_cells+= hits;
 
@@ -16,74 +16,65 @@
 #include "pbnsolve.h"
 #include "read.h"
 
-/* NEW_CELL - make an unknown cell for puzzle with the given number of colors
- * The line[] array is not initialized.  The cell memory allocated can actually
- * be more than the size of the 'struct' if the bit string needs to be longer
- * to hold all our colors.  On most machines, this will only happen if there
- * are more than 32 colors.
- */
-
-Cell *new_cell(color_t ncolor)
-{
-    Cell *cell= (Cell *)malloc(sizeof(Cell) + bit_size(ncolor) - bit_size(1));
-    bit_clearall(cell->bit, ncolor)
-    cell->n= ncolor;
-    return cell;
-}
-
-
 /* INIT_SOLUTION - Initialize a solution grid.  If "set" is true, then all
  * cells are initialized to allow any color.  Otherwise, they are initialized
  * to allow no colors.  The grid size should already have been set in sol.
+ *
+ * All the cells are allocated in one block, and the pointer arrays for all
+ * the lines in each direction in one more block each.  Each cell takes more
+ * than sizeof(Cell) bytes if its bit string needs more than one word to hold
+ * all our colors, which only happens with more than 64 colors.
  */
 
 void init_solution(Puzzle *puz, Solution *sol, int set)
 {
-    line_t i, j, n;
+    line_t i, j, len;
     color_t col;
-    Cell *c;
+    dir_t k;
+    long n;
+    Cell *c, **p;
 
     puz->nsolved= 0;
 
     /* Copy number of directions from puzzle */
     sol->nset= puz->nset;
 
-    n= 0;
     if (puz->type == PT_GRID)
     {
-	/* Build the array of rows */
-	sol->line[D_ROW]= (Cell ***)malloc(sizeof(Cell **) * sol->n[D_ROW]);
+	/* Make all the cells */
 	puz->ncells= sol->n[D_ROW] * sol->n[D_COL];
+	sol->cellsize= sizeof(Cell) +
+	    (bit_size(puz->ncolor) - bit_size(1)) * sizeof(bit_type);
+	sol->cells= (Cell *)malloc(puz->ncells * sol->cellsize);
 
-	for (i= 0; i < sol->n[D_ROW]; i++)
+	for (n= 0; n < puz->ncells; n++)
 	{
-	    sol->line[D_ROW][i]=
-	    	(Cell **)malloc(sizeof(Cell *) * (sol->n[D_COL] + 1));
-
-	    for (j= 0; j < sol->n[D_COL]; j++)
-	    {
-		sol->line[D_ROW][i][j]= c= new_cell(puz->ncolor);
-		c->id= n++;
-		if (set)
-		    for (col= 0; col < puz->ncolor; col++)
-		    	bit_set(c->bit, col);
-		c->line[D_ROW]= i; c->index[D_ROW]= j;
-		c->line[D_COL]= j; c->index[D_COL]= i;
-	    }
-	    sol->line[D_ROW][i][sol->n[D_COL]]= NULL;
+	    c= cell_num(sol, n);
+	    c->id= n;
+	    c->n= puz->ncolor;
+	    bit_clearall(c->bit, puz->ncolor)
+	    if (set)
+		for (col= 0; col < puz->ncolor; col++)
+		    bit_set(c->bit, col);
+	    i= n / sol->n[D_COL]; j= n % sol->n[D_COL];
+	    c->line[D_ROW]= i; c->index[D_ROW]= j;
+	    c->line[D_COL]= j; c->index[D_COL]= i;
 	}
 
-	/* Build the redundant array of cols, pointing to the same cells */
-	sol->line[D_COL]= (Cell ***)malloc(sizeof(Cell **) * sol->n[D_COL]);
-
-	for (i= 0; i < sol->n[D_COL]; i++)
+	/* Build the arrays of rows and columns, pointing into the cells.
+	 * Each line is NULL terminated. */
+	for (k= 0; k < 2; k++)
 	{
-	    sol->line[D_COL][i]=
-	    	(Cell **)malloc(sizeof(Cell *) * (sol->n[D_ROW] + 1));
-
-	    for (j= 0; j < sol->n[D_ROW]; j++)
-		sol->line[D_COL][i][j]= sol->line[D_ROW][j][i];
-	    sol->line[D_COL][i][sol->n[D_ROW]]= NULL;
+	    len= sol->n[1-k];
+	    sol->line[k]= (Cell ***)malloc(sizeof(Cell **) * sol->n[k]);
+	    p= (Cell **)malloc(sizeof(Cell *) * sol->n[k] * (len + 1));
+	    for (i= 0; i < sol->n[k]; i++, p+= len + 1)
+	    {
+		sol->line[k][i]= p;
+		for (j= 0; j < len; j++)
+		    p[j]= line_cell(sol, k, i, j);
+		p[len]= NULL;
+	    }
 	}
     }
     else
@@ -101,11 +92,11 @@ void init_solution(Puzzle *puz, Solution *sol, int set)
 
 int count_solved(Solution *sol)
 {
-    int i,j;
+    long i, ncells= (long)sol->n[D_ROW] * sol->n[D_COL];
     int n= 0;
-    for (i= 0; i < sol->n[D_COL]; i++)
-	for (j= 0; j < sol->n[D_ROW]; j++)
-	    if (sol->line[D_COL][i][j]->n == 1) n++;
+    if (bb_valid(sol)) return bb_count_solved(sol);
+    for (i= 0; i < ncells; i++)
+	if (cell_num(sol,i)->n == 1) n++;
     return n;
 }
 
@@ -135,23 +126,16 @@ Solution *new_solution(Puzzle *puz)
 
 void free_subsolution(Solution *sol)
 {
-    line_t i,j;
     dir_t k;
 
     for (k= 0; k < sol->nset; k++)
     {
-        for (i= 0; i < sol->n[k]; i++)
-	{
-	    if (k == 0)
-	    {
-		/* Only free cells for the first grid, since they are shared */
-	        for (j= 0; sol->line[k][i][j] != NULL; j++)
-		    free(sol->line[k][i][j]);
-	    }
-	    free(sol->line[k][i]);
-	}
+	/* All the lines in a direction share one block */
+	free(sol->line[k][0]);
 	free(sol->line[k]);
     }
+    free(sol->cells);
+    free(sol->spiral);
 }
 
 
@@ -217,9 +201,33 @@ char *solution_string(Puzzle *puz, Solution *sol)
     if (puz->type != PT_GRID)
     	fail("solution_string only works for grid puzzles\n");
 
+    if (bb_valid(sol))
+    {
+	/* Two color grid - read the colors off the bitboard */
+	bit_type *w, *b;
+	for (i= 0; i < sol->n[0]; i++)
+	{
+	    w= bb_white(D_ROW,i);
+	    b= bb_black(D_ROW,i);
+	    for (j= 0; j < sol->n[1]; j++)
+	    {
+		l= ((w[_bit_intn(j)] & _bit_mask(j)) != 0) |
+		   (((b[_bit_intn(j)] & _bit_mask(j)) != 0) << 1);
+		if (l == 3)
+		    (*str++)= '?';
+		else if (l != 0)
+		    (*str++)= puz->color[l >> 1].ch;
+	    }
+	    (*str++)= '\n';
+	}
+	(*str++)= '\0';
+	return buf;
+    }
+
     for (i= 0; i < sol->n[0]; i++)
     {
-	for (j= 0; (cell= sol->line[0][i][j]) != NULL; j++)
+	for (j= 0, cell= grid_cell(sol,i,0); j < sol->n[1];
+		j++, cell= (Cell *)((char *)cell + sol->cellsize))
 	{
 	    if (cell->n > 1)
 		(*str++)= '?';
@@ -244,13 +252,11 @@ char *solution_string(Puzzle *puz, Solution *sol)
 
 int check_nsolved(Puzzle *puz, Solution *sol)
 {
-    line_t i, j;
+    long i, ncells= (long)sol->n[D_ROW] * sol->n[D_COL];
     int cnt= 0;
-    Cell *cell;
 
-    for (i= 0; i < sol->n[0]; i++)
-    	for (j=0; (cell= sol->line[0][i][j]) != NULL; j++)
-	    cnt+= (cell->n == 1);
+    for (i= 0; i < ncells; i++)
+	cnt+= (cell_num(sol,i)->n == 1);
 
     return (puz->nsolved == cnt) ? -1 : cnt;
 }
@@ -264,9 +270,10 @@ int check_nsolved(Puzzle *puz, Solution *sol)
 
 void make_spiral(Solution *sol)
 {
-    line_t i, j, n, s;
+    line_t i, j, n;
     line_t nc= sol->n[D_COL];
     line_t nr= sol->n[D_ROW];
+    int s;
 
     sol->spiral= (Cell **)malloc((nr*nc + 1) * sizeof(Cell *));
     sol->spiral[nr*nc]= NULL;
@@ -277,28 +284,28 @@ void make_spiral(Solution *sol)
 	i= j= n;
 
         for (; j < nc-n-1; j++)
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
 
 	if (2*n == nr-1)
 	{
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
 	    break;
 	}
 
 	for (; i < nr-n-1; i++)
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
 
 	if (2*n == nc-1)
 	{
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
 	    break;
 	}
 
 	for (; j > n; j--)
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
 
 	for (; i > n; i--)
-	    sol->spiral[s++]= sol->line[0][i][j];
+	    sol->spiral[s++]= grid_cell(sol,i,j);
     }
 }
 
@@ -310,10 +317,10 @@ int count_neighbors(Solution *sol, line_t i, line_t j)
     int count= 0;
 
     /* Count number of solved neighbors or edges */
-    if (i == 0 || sol->line[0][i-1][j]->n == 1) count++;
-    if (i == sol->n[0]-1 || sol->line[0][i+1][j]->n == 1) count++;
-    if (j == 0 || sol->line[0][i][j-1]->n == 1) count++;
-    if (sol->line[0][i][j+1]==NULL || sol->line[0][i][j+1]->n == 1) count++;
+    if (i == 0 || grid_cell(sol,i-1,j)->n == 1) count++;
+    if (i == sol->n[0]-1 || grid_cell(sol,i+1,j)->n == 1) count++;
+    if (j == 0 || grid_cell(sol,i,j-1)->n == 1) count++;
+    if (j == sol->n[1]-1 || grid_cell(sol,i,j+1)->n == 1) count++;
 
     return count;
 }
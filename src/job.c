@@ -15,6 +15,8 @@
 
 #include "pbnsolve.h"
 
+extern bit_type *oldval;
+
 #ifdef LINEWATCH
 #define WL(clue) (clue).watch
 #define WC(cell) (puz->clue[0][(cell)->line[0]].watch || puz->clue[1][(cell)->line[1]].watch)
@@ -51,6 +53,7 @@ void job_move(Puzzle *puz, int i, int j)
 
     puz->clue[src->dir][src->n].jobindex= i;
     dst->priority= src->priority;
+    dst->depth= src->depth;
     dst->dir= src->dir;
     dst->n= src->n;
 }
@@ -196,14 +199,18 @@ void add_jobs(Puzzle *puz, Solution *sol, int except, Cell *cell,
 	    j= cell->index[k];
 
 	    /* We only add the job only if either the saved left or right
-	     * solution for the line has been invalidated.
+	     * solution for the line has been invalidated, or undo() marked
+	     * them stale.  The settle solver may find something new after any
+	     * change, so with that we always add it.
 	     */
 	    if (VL || WL(puz->clue[k][i]))
 		printf ("L: CHECK OLD SOLN FOR %s %d CELL %d\n",
 	    	CLUENAME(puz->type,k),i,j);
+	    trail_clue(&puz->clue[k][i]);
 	    lwork= left_check(&puz->clue[k][i], j, cell->bit);
 	    rwork= right_check(&puz->clue[k][i], j, cell->bit);
-	    if (lwork || rwork)
+	    if (lwork || rwork || maysettle ||
+		    puz->clue[k][i].lstale || puz->clue[k][i].rstale)
 	    {
 		add_job(puz, k, i, depth,
 		    newedge(puz, sol->line[k][i], j, old, cell->bit) );
@@ -251,7 +258,8 @@ int next_job(Puzzle *puz, dir_t *k, line_t *i, int *d)
 void init_jobs(Puzzle *puz, Solution *sol)
 {
     dir_t k;
-    line_t i, j, d;
+    line_t i, d;
+    int j;
 
     /* Delete any previously existing heap */
     if (puz->job != NULL) free(puz->job);
@@ -283,6 +291,7 @@ void init_jobs(Puzzle *puz, Solution *sol)
 		puz->job[j].priority= 1000 - d + 2*count_paint(puz,sol,k,i);
 	    puz->job[j].dir= k;
 	    puz->job[j].n= i;
+	    puz->job[j].depth= 0;
 	    puz->clue[k][i].jobindex= j;
 	    j++;
 	}
@@ -290,8 +299,8 @@ void init_jobs(Puzzle *puz, Solution *sol)
 
     /* Build that data into a heap */
     puz->njob= puz->sjob;
-    for (i= puz->njob/2; i > 0; i--)
-    	heapify_jobs(puz,i);
+    for (j= puz->njob/2; j > 0; j--)
+    	heapify_jobs(puz,j);
 }
 
 
@@ -339,6 +348,7 @@ Hist *add_hist2(Puzzle *puz, Cell *cell, color_t oldn, bit_type *oldbit, int bra
     h= HIST(puz, puz->nhist++);
 
     h->branch= branch;
+    if (branch) trail_branch(puz);
     h->cell= cell;
     h->n= oldn;
 
@@ -357,34 +367,28 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
 {
     Hist *h;
     Clue *clue;
-    Cell **line;
     dir_t k;
     int is_branch;
-    line_t i;
 
     while (puz->nhist > 0)
     {
 	h= HIST(puz, puz->nhist-1);
 
-	/* Invalidate any saved positions for lines crossing undone cell.
-	 * We can't just have the fact that nhist < stamp mean the line is
-	 * invalid, because we might backtrack and then advance past stamp
-	 * again before we recheck the line.
+	/* Saved positions for lines crossing the undone cell that were found
+	 * after it was set, or that have been invalidated, will be put back
+	 * to older ones by trail_undo().  Those are still good, but we mark
+	 * them stale, so the lines are rechecked on the next change to them
+	 * as if we had thrown the saved positions away.  This keeps the job
+	 * list the same as it would be without the trail, which matters to
+	 * the depth-limited contradiction search.
 	 */
 	for (k= 0; k < puz->nset; k++)
 	{
-
-	    i= h->cell->line[k];
-	    clue= &(puz->clue[k][i]);
-	    line= sol->line[k][i];
-
-	    if ((VL && VU) || WL(*clue))
-		printf("U: CHECK %s %d", CLUENAME(puz->type,k),i);
-
-	    left_undo(puz, clue, line, h->cell->index[k], h->bit);
-	    right_undo(puz, clue, line,  h->cell->index[k], h->bit);
-
-	    if ((VL && VU) || WL(*clue)) printf("\n");
+	    clue= &puz->clue[k][h->cell->line[k]];
+	    if (clue->lbadb == -1 || puz->nhist <= clue->lstamp)
+		clue->lstale= 1;
+	    if (clue->rbadb == -1 || puz->nhist <= clue->rstamp)
+		clue->rstale= 1;
 	}
 
 	is_branch= h->branch;
@@ -395,6 +399,7 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
 	    if (h->cell->n == 1) solved_a_cell(puz, h->cell, -1);
 
 	    /* Restore saved value */
+	    cell_changed(puz, h->cell, h->bit);
 	    h->cell->n= h->n;
 	    fbit_cpy(h->cell->bit, h->bit);
 
@@ -412,7 +417,12 @@ int undo(Puzzle *puz, Solution *sol, int leave_branch)
 	}
 
 	if (is_branch)
+	{
+	    /* Put back the saved solutions that all the lines had at the
+	     * branch point */
+	    trail_undo(puz);
 	    return 0;
+	}
     }
     return 1;
 }
@@ -459,15 +469,16 @@ int backtrack(Puzzle *puz, Solution *sol)
     if (h->cell->n == 1) solved_a_cell(puz, h->cell, -1);
 
     /* Reset any bits previously set */
-#ifdef LIMITCOLORS
-    h->cell->bit[0]= ((~h->cell->bit[0]) & h->bit[0]);
-#else
-    for (z= 0; z < fbit_size; z++)
-	h->cell->bit[z]= ((~h->cell->bit[z]) & h->bit[z]);
-#endif
+    fbit_cpy(oldval, h->cell->bit);
+    if (fbit_size == 1)
+	h->cell->bit[0]= ((~h->cell->bit[0]) & h->bit[0]);
+    else
+	for (z= 0; z < fbit_size; z++)
+	    h->cell->bit[z]= ((~h->cell->bit[z]) & h->bit[z]);
     h->cell->n= h->n - h->cell->n;  /* Since the bits set in h are always
 				       a superset of those in h->cell,
 				       this should always work */
+    cell_changed(puz, h->cell, oldval);
 
     /* If inverted cell is solved, count it */
     if (h->cell->n == 1) solved_a_cell(puz, h->cell, 1);
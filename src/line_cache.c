@@ -20,44 +20,64 @@
  * state after the line solver has run.  We check this before running the
  * line solver.  If there is a hit, we can avoid the run.
  *
- * The hash table is of fixed size.  If it gets full (or rather 90% full),
- * we simply empty it and start over.
+ * The tables are kept within a memory budget, which is set with the -k
+ * option, or if that isn't given, worked out from the size of the puzzle,
+ * as described in config.h.  Each table starts small.  Each time a new entry
+ * won't fit, or the table gets 90% full, we double its size, but never past
+ * its share of the budget.  Once it can't grow any more, we instead evict an
+ * entry to make room for the new one, choosing it with the CLOCK algorithm:
+ * every entry has a reference bit which is set whenever the entry is added
+ * or found, and a clock hand goes round the entries that the new one could
+ * replace, clearing reference bits, until it comes to an entry whose bit is
+ * already clear.  That one is evicted.  So entries that keep getting hit stay
+ * in the cache, and cold ones age out.
  *
- * If there puzzle is rectangular, we have separate tables for the rows and
- * columns, but if it is square, they are all in the same hash table.
+ * There is one table for each length of compressed line state, so in a
+ * square puzzle the rows and columns share a table, and in a rectangular one
+ * they usually don't.  The tables are not thrown away when a puzzle is done,
+ * so when several puzzles are solved in one run, each one starts with
+ * whatever the ones before it left in the cache.
  *
  * The hash key consists of (1) the clues and (2) the current state of the line.
- * The clues are encoded with clue numbers, which are different for each row
- * and column, except when two happen to have the same clues, in which case they
- * get the same clue id.  The line state is pretty much as usual, except the
- * bits are packed together more closely to reduce memory consumption.
+ * The clues are encoded with clue ids.  Each distinct clue, together with the
+ * length of the line and the number of colors in the puzzle, gets its own id
+ * the first time it is seen in a run, and keeps it for all later puzzles, so
+ * lines with the same clues get the same clue id, whether in the same puzzle
+ * or not.  The line state is pretty much as usual, except the bits are packed
+ * together more closely to reduce memory consumption.
  *
- * The hash algorithm is a standard double probing algorithm.
+ * The table is an array of buckets, each the size of a typical memory cache
+ * line, and each holding a 32-bit fingerprint of the hash value for each of
+ * BUCKET_WAYS entries.  The entries themselves are in a separate array, with
+ * the entries for bucket b in slots b*BUCKET_WAYS on up.  The low bits of the
+ * hash pick the bucket, and the high bits make the fingerprint.  An entry can
+ * only go in its own bucket, and the buckets are filled from the front, so a
+ * search reads one bucket, and only looks at the entries whose fingerprints
+ * match, which for a miss is almost never any.  The number of buckets is
+ * always a power of two, so when the table doubles, the entries of bucket b
+ * are split between buckets b and b plus the old number of buckets.
+ *
+ * Rather than compressing and hashing a line every time we look it up, we
+ * keep the compressed state of every row and column, along with a hash of
+ * it, and update them whenever a cell changes.  The hash is a Zobrist hash:
+ * each bit position of the compressed line has a random word, and the hash
+ * of a line is the exclusive-or of the words for all the bits that are set,
+ * so changing one bit of a cell just toggles one word in.  All the code that
+ * changes cells once solving has started has to call cell_changed().
  */
 
 #include "pbnsolve.h"
 
-/* Number of slots in the hash table.  THIS MUST ALL BE PRIME NUMBERS, each
- * about double the size of the previous one.  Each time the cache is filled,
- * we empty it and replace it with a bigger one.
- */
-
-int nslot[]= {
-     25013,
-     50021,
-    100003,
-    200003,
-    400009,
-    800011,
-    	0};
-
-/* Hash Element Structure.  clid is zero if this slot is empty.  "data" is
- * actually two variable length bit strings, oldstate and newstate, oldstate
- * being part of the key, and new state being the value.
+/* Hash Element Structure.  "data" is actually two variable length bit
+ * strings, oldstate and newstate, oldstate being part of the key, and new
+ * state being the value.  An entry is in use if its fingerprint in its bucket
+ * is not zero.
  */
 
 typedef struct {
     line_t clid;	/* Clue ID.  Identifies the clue.  Part of key */
+    char ref;		/* Reference bit for CLOCK eviction */
+    int puzzle;		/* Number of the puzzle that added it */
     bit_type data[2];	/* The old and new line states.  Actual length is
                            2*hash.len */
 } HashElem;
@@ -67,37 +87,130 @@ typedef struct {
 #define newstate(h,e) ((e)->data+(h)->len)
 #define HashElemSize(h) (sizeof(HashElem) + (2*(h)->len - 2) * sizeof(bit_type))
 
+/* Buckets are 64 bytes, and are allocated on 64 byte boundaries */
+#define BUCKET_BYTES 64
+#define BUCKET_WAYS (BUCKET_BYTES / sizeof(unsigned int))
+
 typedef struct {
+    unsigned int fp[BUCKET_WAYS];	/* Fingerprints.  Zero if unused */
+} Bucket;
+
+#define fingerprint(v) ((unsigned int)((v) >> (_bit_intsiz - 32)) | 1)
+
+typedef struct linehash {
+    struct linehash *next;	/* Next table in the list of all tables */
     int len;		/* Length (in number of longs) of keys and values */
     int esize;		/* Element size in bytes - just HashElemSize(h) */
-    long nslots;	/* Number of slots in the hash table */
-    int nsloti;		/* Index into nslot[] array for current slot size */
-    long flushat;	/* Flush the hash table if it gets this full */
+    long nbucket;	/* Number of buckets - always a power of two */
+    long maxbucket;	/* Largest number of buckets within our budget */
+    long flushat;	/* Grow the table if it gets this full */
+    long growat;	/* Or if it is this full and a bucket is full */
     long n;		/* Number of data elements currently in hash */
-    long lastslot;	/* Slot found by last search - -1 if no last search */
-    char *hash;		/* Pointer to the memory containing the hash */
+    long hand;		/* Where the CLOCK hand starts in a bucket */
+    long lastbucket;	/* Bucket searched by last search - -1 if none */
+    int lastway;	/* First free entry in that bucket - -1 if full */
+    bit_type lastv;	/* Hash value of the last search */
+    Bucket *bucket;	/* The buckets */
+    char *hash;		/* Pointer to the memory containing the entries */
 } LineHash;
 
-#define HashSlot(h,i) (HashElem *)&((h)->hash[i * (h)->esize])
+#define HashSlot(h,i) ((HashElem *)&((h)->hash[(i) * (h)->esize]))
+#define BucketSlot(h,b,w) HashSlot(h, (b) * BUCKET_WAYS + (w))
 
 
 /* These are the roots of the caches.  We have two, one for rows and one for
- * columns, though they are merged for square puzzles */
+ * columns, which are the same table if the lines are the same size.  All the
+ * tables made in this run are on the tables list. */
 static LineHash *cache[2];
+static LineHash *tables= NULL;
 
 /* This attaches a line ID to each row and each column.  Normally each one
  * would have a different ID number, but if two lines are the same length
  * and have the same clues, then they have the same clue id.  If one clue
  * is the same as another clue reversed, then the first one found gets a
  * positive clue id, and the second gets the negative of that value.
+ * These are also used by the line tables in line_table.c.
+ */
+static line_t *clid[2]= {NULL, NULL};
+static int nextclid= 1;
+
+/* Incremented each time the clue ids are flushed and given out again */
+int clid_generation= 0;
+
+/* The clue registry remembers every clue that has been given an id in this
+ * run, so later puzzles can find them.  It is a hash table, chained through
+ * the records.  The hash doesn't depend on the order of the blocks, so a clue
+ * and its reverse are in the same chain.
  */
-static line_t *clid[2];
+typedef struct cluerec {
+    struct cluerec *next;	/* Next record in the chain */
+    line_t clid;		/* The clue id */
+    line_t linelen;		/* Length of the line */
+    color_t ncolor;		/* Number of colors in the puzzle */
+    line_t n;			/* Number of blocks */
+    line_t *length;		/* Block lengths */
+    color_t *color;		/* Block colors */
+} ClueRec;
+
+#define CLUE_BUCKETS 4096
+static ClueRec *clueset[CLUE_BUCKETS];
+
+/* Clue ids have to fit in a line_t */
+#define MAXCLID ((1L << (8 * sizeof(line_t) - 1)) - 1)
 
 /* A temporary storage place for a compressed bit array */
 static bit_type *tmp;
 
+/* The compressed state of each row and column, in the same form as the
+ * hash keys, and the Zobrist hash of each.  These are built the first time
+ * line_cache() is called, and kept up to date by cell_changed() after that.
+ * Lines with negative clue ids are stored reversed, just as in the cache.
+ * zobrist[p] is the random word for bit p of a compressed line, counting
+ * from the high order bit of the first word.
+ */
+static bit_type *pack[2]= {NULL, NULL};
+static bit_type *sig[2];
+static bit_type *zobrist= NULL;
+static long nzobrist= 0;
+static int packlen[2];
+static int packready= 0;
+#define packed(k,i) (pack[k] + (i)*packlen[k])
+
 /* A storage place for an uncompressed solution */
 static bit_type *col;
+
+/* Lookup statistics for each row and column.  Some lines almost never get a
+ * hit, and for those the lookup and the add are wasted work.  So lookups of
+ * each line are sampled in groups of CACHE_SAMPLE.  If fewer than
+ * CACHE_MINHITS of a sample hit, apply_lro() bypasses the cache for the next
+ * CACHE_BYPASS times the line is solved, and then we take another sample.
+ */
+typedef struct {
+    long req;		/* Number of lookups */
+    long hit;		/* Number of lookups that hit */
+    long bypass;	/* Number of times the cache was bypassed */
+    int sreq, shit;	/* Lookups and hits in the current sample */
+    int skip;		/* Bypass the cache this many more times */
+} LineStat;
+
+static LineStat *lstat[2]= {NULL, NULL};
+
+/* The segments of the last line split by split_line(), described with it
+ * below, and their compressed states.
+ */
+typedef struct {
+    line_t lo, hi;	/* The segment is cells lo through hi-1 */
+    line_t b0, b1;	/* It holds blocks b0 through b1-1 */
+    line_t clid;	/* Clue id of the segment.  Negative if reversed */
+    bit_type v;		/* Hash value of its state */
+    char hit;		/* Was it found in the cache? */
+} Segment;
+
+static Segment *seg= NULL;	/* Segments of the last line split */
+static int nseg;		/* Number of segments */
+static bit_type *segkey;	/* Compressed states of the segments */
+static int segstride;		/* Words for each segment in segkey */
+#define segstate(s) (segkey + (s)*segstride)
 #define colbit(i) (col+(fbit_size*(i)))
 
 /* Forward declarations of some functions */
@@ -108,25 +221,91 @@ void rev_compress_line(Puzzle *puz, Solution *sol,
 void uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out);
 void rev_uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out);
 void dump_comp(bit_type *c, int ncell, int ncolor);
+bit_type state_hash(bit_type *line, int len);
+bit_type hash_index(line_t clid, bit_type *line, int len);
+void init_pack(Puzzle *puz);
+void pack_lines(Puzzle *puz, Solution *sol);
+static bit_type next_zobrist(bit_type *seed);
+void set_budget(LineHash *hash, long budget);
+HashElem *new_entry(Puzzle *puz, dir_t k, line_t i);
+static HashElem *insert_entry(LineHash *h, line_t id, bit_type *state);
 
 /* Hash statistics */
 long cache_req= 0;
 long cache_hit= 0;
+long cache_xhit= 0;	/* Hits on entries added by earlier puzzles */
 long cache_add= 0;
-long cache_flush= 0;
+long cache_evict= 0;
+long cache_rehash= 0;
+long cache_bytes= 0;
+long cache_bypass= 0;
+
 
-/* INIT_HASH: Some initialization of a hash in an empty state.  Does not
+
+/* INIT_HASH: Some initialization of a hash in an empty state, for line
+ * states len words long.  The table may use at most 'budget' bytes of
+ * memory, and will initially have room for about 'start' elements.  Does not
  * allocate the hash->hash array.
  */
 
-void init_hash(LineHash **hash, line_t ncell, color_t ncolor)
+void init_hash(LineHash **hash, int len, long budget, long start)
 {
     *hash= (LineHash *)malloc(sizeof(LineHash));
-    (*hash)->len= bit_size( ncell * ncolor );
+    (*hash)->len= len;
     (*hash)->esize= HashElemSize(*hash);
-    (*hash)->nsloti= 0;
+
+    set_budget(*hash, budget);
+    for ((*hash)->nbucket= 1;
+	    (*hash)->nbucket * BUCKET_WAYS < start &&
+	    (*hash)->nbucket < (*hash)->maxbucket; )
+	(*hash)->nbucket*= 2;
+
     (*hash)->n= 0;
-    (*hash)->lastslot= -1;
+    (*hash)->hand= 0;
+    (*hash)->lastbucket= -1;
+
+    if (VH) printf("H:   Hash size %ld buckets, budget %ld buckets\n",
+	    (*hash)->nbucket, (*hash)->maxbucket);
+}
+
+
+/* SET_BUDGET:  Work out how many buckets a hash table may grow to without
+ * using more than 'budget' bytes of memory.
+ */
+
+void set_budget(LineHash *hash, long budget)
+{
+    long bsize, minbucket;
+
+    /* Memory for one bucket, with its entries */
+    bsize= sizeof(Bucket) + BUCKET_WAYS * hash->esize;
+
+    for (minbucket= 1; minbucket * BUCKET_WAYS < CACHE_MINSLOTS; )
+	minbucket*= 2;
+    for (hash->maxbucket= minbucket; 2 * hash->maxbucket * bsize <= budget; )
+	hash->maxbucket*= 2;
+}
+
+
+/* SET_LIMITS:  Set the fill limit of a hash table for its current size. */
+
+void set_limits(LineHash *hash)
+{
+    hash->flushat= hash->nbucket * BUCKET_WAYS * 9 / 10;
+    hash->growat= hash->nbucket * BUCKET_WAYS / 2;
+}
+
+
+/* ALLOC_BUCKETS:  Allocate n empty buckets, aligned to their size. */
+
+Bucket *alloc_buckets(long n)
+{
+    void *b;
+
+    if (posix_memalign(&b, BUCKET_BYTES, n * sizeof(Bucket)))
+	fail("Out of memory for line cache\n");
+    memset(b, 0, n * sizeof(Bucket));
+    return (Bucket *)b;
 }
 
 
@@ -134,67 +313,307 @@ void init_hash(LineHash **hash, line_t ncell, color_t ncolor)
 
 void alloc_hash(LineHash *hash)
 {
-    hash->nslots= nslot[hash->nsloti];
-    hash->flushat= hash->nslots * 9 / 10;
-    hash->hash= (char *)calloc(hash->nslots, hash->esize);
+    set_limits(hash);
+    hash->bucket= alloc_buckets(hash->nbucket);
+    hash->hash= (char *)malloc(hash->nbucket * BUCKET_WAYS * hash->esize);
+    cache_bytes+= hash->nbucket * (sizeof(Bucket) + BUCKET_WAYS * hash->esize);
+}
+
+
+/* FREE_WAY: Return the first free entry in bucket b, or -1 if it is full. */
+
+int free_way(LineHash *hash, long b)
+{
+    int w;
+
+    for (w= 0; w < BUCKET_WAYS; w++)
+	if (hash->bucket[b].fp[w] == 0) return w;
+    return -1;
 }
 
-/* EMPTY_HASH: Flush out the hash table, deleting all entries.
+
+/* GROW_HASH: Double the number of buckets in the hash table.  Each entry of
+ * bucket b either stays in bucket b or moves to bucket b+nbucket, depending
+ * on the next bit of its hash value, so we can do this in place, except for
+ * the buckets themselves, which are small.
  */
 
-void empty_hash(LineHash *hash)
+void grow_hash(LineHash *hash)
 {
-    hash->n= 0;
-    hash->lastslot= -1;
-    if (nslot[hash->nsloti+1] > 0)
+    long nb= hash->nbucket, b, to;
+    int w, nw[2];
+    Bucket *old= hash->bucket;
+    HashElem *e;
+    bit_type v;
+
+    hash->hash= (char *)realloc(hash->hash, 2*nb * BUCKET_WAYS * hash->esize);
+    hash->bucket= alloc_buckets(2*nb);
+    cache_bytes+= nb * (sizeof(Bucket) + BUCKET_WAYS * hash->esize);
+
+    for (b= 0; b < nb; b++)
     {
-	hash->nslots= nslot[++hash->nsloti];
-	hash->flushat= hash->nslots * 9 / 10;
-	free(hash->hash);
-	hash->hash= (char *)calloc(hash->nslots, hash->esize);
+	nw[0]= nw[1]= 0;
+	for (w= 0; w < BUCKET_WAYS && old[b].fp[w] != 0; w++)
+	{
+	    e= BucketSlot(hash, b, w);
+	    v= hash_index(clueid(e), oldstate(e), hash->len);
+	    to= (v & nb) ? 1 : 0;
+	    hash->bucket[b + to*nb].fp[nw[to]]= old[b].fp[w];
+	    if (to || nw[0] < w)
+		memmove(BucketSlot(hash, b + to*nb, nw[to]), e, hash->esize);
+	    nw[to]++;
+	}
     }
-    else
-	memset(hash->hash, 0, hash->nslots * hash->esize);
-    if (VH) printf("H: New hash size=%d\n",hash->nslots);
-    cache_flush++;
+    free(old);
+
+    hash->nbucket= 2*nb;
+    set_limits(hash);
+    hash->lastbucket= -1;
+
+    if (VH) printf("H: New hash size=%ld buckets\n",hash->nbucket);
+    cache_rehash++;
 }
 
 
-/* MATCH_CLUE:  Does any clue in direction k, with an index less than n
- * match the given clue?  If not return 0.  If so return the clue id of
- * that clue.  If it matches a reversed clue, then return the negative of
- * the clue id.
+/* EVICT_ONE: Evict one entry from bucket b, which must be full, selecting it
+ * by the CLOCK algorithm, and return the way that is now free.
  */
 
-int match_clue(Clue *clue, Puzzle *puz, int k, int n)
+int evict_one(LineHash *hash, long b)
 {
-    Clue *c;
-    int i, j;
-    int len;
+    HashElem *e;
+    int w;
 
-    for (i= 0; i < n; i++)
+    while (1)
     {
-	c= &(puz->clue[k][i]);
-	len= c->n;
-	if (len != clue->n) goto next;
-	/* Try matching two clues */
-	for (j= 0; j < len; j++)
+	w= hash->hand;
+	if (++hash->hand == BUCKET_WAYS) hash->hand= 0;
+
+	e= BucketSlot(hash, b, w);
+	if (e->ref)
 	{
-	    if (clue->length[j] != c->length[j] ||
-		clue->color[j] != c->color[j]) goto rev;
+	    /* Recently used - give it another chance */
+	    e->ref= 0;
+	    continue;
 	}
-	return clid[k][i];
+
+	if (VH) printf("H: evicting bucket %ld entry %d\n", b, w);
+	cache_evict++;
+	return w;
+    }
+}
+
+
+/* CLUE_BUCKET:  Pick the clue registry chain for a clue of n blocks, with the
+ * given lengths and colors, for a line of linelen cells in a puzzle with
+ * ncolor colors.  The blocks are summed, so a clue and its reverse give the
+ * same chain.
+ */
+
+static int clue_bucket(line_t n, line_t *length, color_t *color,
+	line_t linelen, color_t ncolor)
+{
+    bit_type h;
+    line_t j;
+
+    h= ((bit_type)linelen << 16 | (bit_type)ncolor << 8 | n) *
+	0x9e3779b97f4a7c15UL;
+    for (j= 0; j < n; j++)
+	h+= ((bit_type)length[j] << 8 | (bit_type)color[j]) *
+	    0xbf58476d1ce4e5b9UL;
+    h^= h >> 31;
+    h*= 0x94d049bb133111ebUL;
+    return (h >> 32) & (CLUE_BUCKETS - 1);
+}
+
+
+/* MATCH_CLUE:  Is the given clue, for a line of linelen cells in a puzzle
+ * with ncolor colors, the one in registry record r?  If not return 0.  If so
+ * return the clue id of the record.  If it matches the record reversed, then
+ * return the negative of the clue id.
+ */
+
+static int match_clue(ClueRec *r, line_t len, line_t *length, color_t *color,
+	line_t linelen, color_t ncolor)
+{
+    int j;
+
+    if (r->linelen != linelen || r->ncolor != ncolor || r->n != len)
+	return 0;
+    /* Try matching two clues */
+    for (j= 0; j < len; j++)
+    {
+	if (length[j] != r->length[j] || color[j] != r->color[j]) goto rev;
+    }
+    return r->clid;
 rev:	/* Try matching to reverse of clue */
-	if (len < 2) goto next;
-	for (j= 0; j < len; j++)
+    if (len < 2) return 0;
+    for (j= 0; j < len; j++)
+    {
+	if (length[len-j-1] != r->length[j] ||
+	    color[len-j-1] != r->color[j]) return 0;
+    }
+    return -r->clid;
+}
+
+
+/* REGISTER_BLOCKS:  Return the clue id of a clue of n blocks, with the given
+ * lengths and colors, for a line of linelen cells in a puzzle with ncolor
+ * colors, giving it a new one if no clue like it has been seen before in
+ * this run.  If it needs a new one and we are out of ids, return 0.
+ */
+
+static line_t register_blocks(line_t n, line_t *length, color_t *color,
+	line_t linelen, color_t ncolor)
+{
+    int b= clue_bucket(n, length, color, linelen, ncolor);
+    ClueRec *r;
+    line_t id;
+
+    for (r= clueset[b]; r != NULL; r= r->next)
+	if ((id= match_clue(r, n, length, color, linelen, ncolor)) != 0)
+	    return id;
+
+    if (nextclid > MAXCLID) return 0;
+
+    r= (ClueRec *)malloc(sizeof(ClueRec));
+    r->clid= nextclid++;
+    r->linelen= linelen;
+    r->ncolor= ncolor;
+    r->n= n;
+    r->length= (line_t *)malloc(n * sizeof(line_t));
+    memcpy(r->length, length, n * sizeof(line_t));
+    r->color= (color_t *)malloc(n * sizeof(color_t));
+    memcpy(r->color, color, n * sizeof(color_t));
+    r->next= clueset[b];
+    clueset[b]= r;
+    return r->clid;
+}
+
+
+/* REGISTER_CLUE:  Return the clue id of the clue for line i in direction k.
+ * This is done before clue_init() has set clue->linelen, so we get the line
+ * length from the size of the grid.
+ */
+
+static line_t register_clue(Puzzle *puz, dir_t k, line_t i)
+{
+    Clue *clue= &(puz->clue[k][i]);
+
+    return register_blocks(clue->n, clue->length, clue->color,
+	    puz->n[1-k], puz->ncolor);
+}
+
+
+/* FLUSH_CACHE:  Forget all the clue ids given out so far, and empty all the
+ * cache tables, since their entries are keyed by those ids.  This is done
+ * when a long run has seen so many different clues that it is about to run
+ * out of ids.
+ */
+
+static void flush_cache(void)
+{
+    ClueRec *r, *next;
+    LineHash *h;
+    int b;
+
+    if (VH) printf("H: Out of clue ids - flushing cache\n");
+
+    for (b= 0; b < CLUE_BUCKETS; b++)
+    {
+	for (r= clueset[b]; r != NULL; r= next)
+	{
+	    next= r->next;
+	    free(r->length);
+	    free(r->color);
+	    free(r);
+	}
+	clueset[b]= NULL;
+    }
+    nextclid= 1;
+    clid_generation++;
+
+    for (h= tables; h != NULL; h= h->next)
+    {
+	memset(h->bucket, 0, h->nbucket * sizeof(Bucket));
+	h->n= 0;
+	h->hand= 0;
+	h->lastbucket= -1;
+    }
+}
+
+
+/* INIT_CLUE_IDS: Assign a clue id to each row and column of a grid puzzle.
+ * Lines with identical clues get the same id, and lines whose clues are the
+ * reverse of each other get ids that are negatives of each other.  Ids are
+ * kept from one puzzle to the next.  Returns one more than the largest id
+ * assigned so far.  Safe to call more than once for a puzzle.
+ */
+
+int init_clue_ids(Puzzle *puz)
+{
+    int k, i;
+
+    if (clid[D_ROW] != NULL) return nextclid;
+
+    if (nextclid + puz->n[D_ROW] + puz->n[D_COL] > MAXCLID)
+	flush_cache();
+
+    /* Build clue id arrays */
+    clid[D_ROW]= (line_t *)malloc(sizeof(line_t) * puz->n[D_ROW]);
+    clid[D_COL]= (line_t *)malloc(sizeof(line_t) * puz->n[D_COL]);
+
+    if (VH) printf("H:   Assigning Clue IDs:\n");
+
+    for (k= 0; k < 2; k++)
+    {
+	for (i= 0; i < puz->n[k]; i++)
 	{
-	    if (clue->length[len-j-1] != c->length[j] ||
-		clue->color[len-j-1] != c->color[j]) goto next;
+	    clid[k][i]= register_clue(puz, k, i);
+	    if (VH) printf("H:     %s %d => %d\n",
+			cluename(puz->type,k), i, clid[k][i]);
 	}
-	return -clid[k][i];
-next:;
     }
-    return 0;
+    return nextclid;
+}
+
+
+/* CLUE_ID: Return the clue id of line i in direction k.  Only valid after
+ * init_clue_ids() has been called.
+ */
+
+line_t clue_id(dir_t k, line_t i)
+{
+    return clid[k][i];
+}
+
+
+/* GET_HASH: Return the table for line states len words long, making it if
+ * there isn't one yet.  A table made for an earlier puzzle may grow to the
+ * larger of its old budget and the new one.
+ */
+
+LineHash *get_hash(int len, long budget, long start)
+{
+    LineHash *h;
+    long maxbucket;
+
+    for (h= tables; h != NULL; h= h->next)
+	if (h->len == len)
+	{
+	    maxbucket= h->maxbucket;
+	    set_budget(h, budget);
+	    if (h->maxbucket < maxbucket) h->maxbucket= maxbucket;
+	    h->lastbucket= -1;
+	    if (VH) printf("H:   Reusing hash with %ld entries.\n",h->n);
+	    return h;
+	}
+
+    init_hash(&h, len, budget, start);
+    alloc_hash(h);
+    h->next= tables;
+    tables= h;
+    return h;
 }
 
 
@@ -203,9 +622,11 @@ next:;
 
 void init_cache(Puzzle *puz)
 {
-    int k, i, square;
-    int nextclid= 1;
+    int k, square;
     int maxdimension= 0;
+    line_t i, maxcluelen= 0;
+    long nline= puz->n[D_ROW] + puz->n[D_COL];
+    long budget;
 
     if (VH) printf("H: Initializing Hash.\n");
 
@@ -216,129 +637,353 @@ void init_cache(Puzzle *puz)
 	return;
     }
 
-    /* Construct the hash for rows */
-    init_hash(&(cache[D_ROW]), puz->n[D_COL], puz->ncolor);
+    for (k= 0; k < 2; k++)
+	if (puz->n[k] > maxdimension) maxdimension= puz->n[k];
+
+    /* Work out our memory budget */
+    if (cachemb > 0)
+	budget= cachemb * 1024L * 1024L;
+    else
+    {
+	budget= CACHE_PERLINE * nline *
+	    (sizeof(HashElem) + 2 * bit_size(maxdimension * puz->ncolor) *
+	     sizeof(bit_type));
+	if (budget > CACHE_MB_MAX * 1024L * 1024L)
+	    budget= CACHE_MB_MAX * 1024L * 1024L;
+    }
+    if (VH) printf("H:   Budget %ld bytes.\n",budget);
+
+    init_pack(puz);
 
-    /* Construct the hash for columns */
     square= (puz->n[D_ROW] == puz->n[D_COL]);
     if (!square)
     {
-	/* For rectangular puzzles,
-	 * we use separate caches for rows and columns */
-	init_hash(&(cache[D_COL]), puz->n[D_ROW], puz->ncolor);
-	alloc_hash(cache[D_ROW]);
-	if (VH) printf("H:   Using two hash tables.\n");
+	/* For rectangular puzzles, rows and columns are usually in different
+	 * tables, so we divide the budget between them by number of lines */
+	for (k= 0; k < 2; k++)
+	    cache[k]= get_hash(packlen[k], budget * puz->n[k] / nline,
+		CACHE_STARTLINE * puz->n[k]);
     }
     else
     {
-	/* For square puzzles, we use just one cache but double size */
-	cache[D_ROW]->nsloti++;
-	cache[D_COL]= cache[D_ROW];
-	if (VH) printf("H:   Using one hash table.\n");
+	/* For square puzzles, we use just one cache with the whole budget */
+	cache[D_ROW]= cache[D_COL]=
+	    get_hash(packlen[D_ROW], budget, CACHE_STARTLINE * nline);
     }
-    alloc_hash(cache[D_COL]);
 
-    /* Build clue id arrays */
-    clid[D_ROW]= (line_t *)malloc(sizeof(line_t) * puz->n[D_ROW]);
-    clid[D_COL]= (line_t *)malloc(sizeof(line_t) * puz->n[D_COL]);
+    /* Allocate storage for a compressed row or column */
+    tmp= (bit_type *)malloc(
+	    bit_size(maxdimension * puz->ncolor) * sizeof(bit_type));
+
+    /* Allocate storage for an uncompressed row or column */
+    col= (bit_type *)malloc( maxdimension * fbit_size * sizeof(bit_type));
+
+    /* Allocate the line statistics */
+    for (k= 0; k < 2; k++)
+	lstat[k]= (LineStat *)calloc(puz->n[k], sizeof(LineStat));
+
+    /* Allocate storage for the segments of a line.  No line has more
+     * segments than blocks.  */
+    for (k= 0; k < 2; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	    if (puz->clue[k][i].n > maxcluelen)
+		maxcluelen= puz->clue[k][i].n;
+    seg= (Segment *)malloc((maxcluelen + 1) * sizeof(Segment));
+    segstride= (packlen[D_ROW] > packlen[D_COL]) ?
+	packlen[D_ROW] : packlen[D_COL];
+    segkey= (bit_type *)malloc((maxcluelen + 1) * segstride * sizeof(bit_type));
+}
 
-    if (VH) printf("H:   Assigning Clue IDs:\n");
 
-    /* Assign a clue id to each row and column - not a terribly fast algorithm
-     * but who cares?  Puzzles aren't that big. */
+/* INIT_PACK: Allocate the packed line states and make up the Zobrist words.
+ * This is used by both the line cache and the feasibility cache, and does
+ * nothing if it has already been done for this puzzle.  The states
+ * themselves are filled in later, by pack_lines().
+ */
+
+void init_pack(Puzzle *puz)
+{
+    int k;
+    long j, n;
+    int nbit;
+    line_t maxdimension= 0;
+    bit_type seed;
+
+    if (pack[D_ROW] != NULL) return;
+
+    init_clue_ids(puz);
+
     for (k= 0; k < 2; k++)
     {
+	nbit= puz->n[1-k] * puz->ncolor;
+	packlen[k]= bit_size(nbit);
+	pack[k]= (bit_type *)malloc(puz->n[k] * packlen[k] * sizeof(bit_type));
+	sig[k]= (bit_type *)malloc(puz->n[k] * sizeof(bit_type));
 	if (puz->n[k] > maxdimension) maxdimension= puz->n[k];
+    }
+
+    /* We always use the same seed, so runs are repeatable, and a cache entry
+     * made for one puzzle has the same hash in the next one */
+    n= bit_size(maxdimension * puz->ncolor) * _bit_intsiz;
+    if (n > nzobrist)
+    {
+	zobrist= (bit_type *)realloc(zobrist, n * sizeof(bit_type));
+	for (seed= 0, j= 0; j < n; j++)
+	    zobrist[j]= next_zobrist(&seed);
+	nzobrist= n;
+    }
+    packready= 0;
+}
+
+
+/* PACK_LINES: Build the compressed state and Zobrist hash of every row and
+ * column from scratch.
+ */
+
+void pack_lines(Puzzle *puz, Solution *sol)
+{
+    dir_t k;
+    line_t i, ncell;
+    bit_type *pk;
 
+    for (k= 0; k < 2; k++)
 	for (i= 0; i < puz->n[k]; i++)
 	{
-	    if ((clid[k][i]= match_clue(&(puz->clue[k][i]), puz, k, i)) == 0)
+	    pk= packed(k,i);
+	    ncell= puz->clue[k][i].linelen;
+	    memset(pk, 0, packlen[k] * sizeof(bit_type));
+	    if (clid[k][i] > 0)
+		compress_line(puz, sol, k, i, ncell, pk);
+	    else
+		rev_compress_line(puz, sol, k, i, ncell, pk);
+	    sig[k][i]= state_hash(pk, packlen[k]);
+	}
+    packready= 1;
+}
+
+
+/* REPACK_LINES: Cells have been changed without calling cell_changed(), so
+ * the compressed line states have to be rebuilt before they are used again.
+ */
+
+void repack_lines(void)
+{
+    packready= 0;
+    bb_sol= NULL;
+}
+
+
+/* CELL_CHANGED: Update the compressed states and hashes of the lines through
+ * a cell whose value has changed.  'bit' is the value before the change.
+ * Since all we do is toggle the bits that differ, this may equally well be
+ * called before the change with 'bit' the new value.
+ */
+
+void cell_changed(Puzzle *puz, Cell *cell, bit_type *bit)
+{
+    dir_t k;
+    line_t i, j;
+    color_t c;
+    int p, m;
+    bit_type *pk, d;
+
+    if (bb_sol != NULL) bb_changed(cell, bit);
+    if (!packready) return;
+
+    /* With one word per cell, we can find the changed colors all at once */
+    d= (fbit_size == 1) ? bit[0] ^ cell->bit[0] : _bit_1s;
+
+    for (k= 0; k < 2; k++)
+    {
+	i= cell->line[k];
+	j= cell->index[k];
+	if (clid[k][i] < 0) j= puz->clue[k][i].linelen - 1 - j;
+	pk= packed(k,i);
+	for (c= 0; c < puz->ncolor; c++)
+	    if ((fbit_size == 1) ? (d & _bit_mask(c)) != 0 :
+		    !bit_test(bit,c) != !may_be(cell,c))
 	    {
-		if (k == 0 || !square ||
-		    (clid[k][i]= match_clue(&(puz->clue[k][i]),
-					    puz, 0, puz->n[0])) == 0)
-		{
-		    clid[k][i]= nextclid++;
-		}
+		/* compress_line() packs each word of the cell's bit string
+		 * high bit first, and only the used bits of the last word */
+		m= (c / _bit_intsiz == fbit_size - 1) ?
+		    puz->ncolor - (fbit_size-1)*_bit_intsiz : _bit_intsiz;
+		p= j * puz->ncolor + (c / _bit_intsiz) * _bit_intsiz +
+		    m - 1 - c % _bit_intsiz;
+		pk[p / _bit_intsiz]^=
+		    (bit_type)1 << (_bit_intsiz - 1 - p % _bit_intsiz);
+		sig[k][i]^= zobrist[p];
 	    }
-	    if (VH) printf("H:     %s %d => %d\n",
-			cluename(puz->type,k), i, clid[k][i]);
-	}
     }
+}
 
-    /* Allocate storage for a compressed row or column */
-    tmp= (bit_type *)malloc(
-	    bit_size(maxdimension * puz->ncolor) * sizeof(bit_type));
 
-    /* Allocate storage for an uncompressed row or column */
-    col= (bit_type *)malloc( maxdimension * fbit_size * sizeof(bit_type));
+/* NEXT_ZOBRIST: Return the next pseudo-random word from the sequence whose
+ * state is *seed.  This is the splitmix64 generator.
+ */
+
+static bit_type next_zobrist(bit_type *seed)
+{
+    bit_type z= (*seed+= 0x9e3779b97f4a7c15UL);
+
+    z= (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+    z= (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+    return z ^ (z >> 31);
 }
 
 
-/* HASH_INDEX: Given a clue id and a compressed line, generate an integer
- * index by hashing it all together.
+/* CLUE_HASH: Combine a clue id with the Zobrist hash of a line state to get
+ * the hash index.
  */
 
-bit_type hash_index(line_t clid, bit_type *line, int len)
+#define clue_hash(clid, sig) ((bit_type)(clid) * 0xff51afd7ed558ccdUL ^ (sig))
+
+
+/* STATE_HASH: Work out the Zobrist hash of a compressed line from scratch.
+ */
+
+bit_type state_hash(bit_type *line, int len)
 {
-    int i;
-    bit_type result= clid;
+    int i, p;
+    bit_type x, result= 0;
 
     for (i= 0; i < len; i++)
-	/* This is  result= 9*result + line[i] */
-	result+= (result<<3) + line[i];
+	for (x= line[i], p= i * _bit_intsiz; x != 0; x<<= 1, p++)
+	    if (x >> (_bit_intsiz - 1))
+		result^= zobrist[p];
     return result;
 }
 
 
+/* HASH_INDEX: Given a clue id and a compressed line, generate an integer
+ * index by hashing it all together.  This gives the same result as looking
+ * up the line's hash in sig[], but works it out from scratch, for use when
+ * rebuilding the table.
+ */
+
+bit_type hash_index(line_t clid, bit_type *line, int len)
+{
+    return clue_hash(clid, state_hash(line, len));
+}
+
+
 
-/* HASH_FIND: Given a key, find the entry in the hash table.  If found, return
- * the index.  If not found, return the index of the empty cell we found
- * instead.  If the table is full return a -1, but that should never happen.
+/* HASH_FIND: Given a key, and its hash index v, find the entry in the hash
+ * table.  If found, return the slot number.  If not found, return -1, and
+ * leave the bucket and the free entry in it, if any, where new_entry() can
+ * find them.
  */
 
-int hash_find(LineHash *hash, line_t clid, bit_type *line)
+long hash_find(LineHash *hash, line_t clid, bit_type *line, bit_type v)
 {
-    int i,j;
+    long b= v & (hash->nbucket - 1);
+    unsigned int f= fingerprint(v);
+    unsigned int *fp= hash->bucket[b].fp;
+    int w, j;
     HashElem *e;
-    bit_type v= hash_index(clid, line, hash->len);
-    int index= v % hash->nslots;
-    int offset= (v % (hash->nslots - 2)) + 1;
 
-    if (VH) printf("H: hash search - index=%d offset=%d\n", index, offset);
+    if (VH) printf("H: hash search - bucket=%ld fingerprint=%x\n", b, f);
     cache_req++;
 
-    for (i=0; i < hash->nslots; i++)
+    hash->lastbucket= b;
+    hash->lastv= v;
+    for (w= 0; w < BUCKET_WAYS; w++)
     {
-	e= HashSlot(hash,index);
-
-	/* check for empty slot */
-	if (clueid(e) == 0)
+	/* check for empty entry - the rest of the bucket is empty too */
+	if (fp[w] == 0)
 	{
-	    if (VH) printf("H:   slot %d - empty\n", index);
-	    return index;
+	    if (VH) printf("H:   entry %d - empty\n", w);
+	    hash->lastway= w;
+	    return -1;
 	}
 
 	/* check for hit */
-	if (clueid(e) == clid && oldstate(e)[0] == line[0])
+	if (fp[w] != f) continue;
+	e= BucketSlot(hash, b, w);
+	if (clueid(e) == clid)
 	{
-	    for (j= 1; j < hash->len; j++)
+	    for (j= 0; j < hash->len; j++)
 		if (oldstate(e)[j] != line[j])
 		    goto nope;
-	    if (VH) printf("H:   slot %d - matches\n", index);
+	    if (VH) printf("H:   entry %d - matches\n", w);
+	    e->ref= 1;
 	    cache_hit++;
-	    return index;
-	nope:;
+	    if (e->puzzle != puzzleno) cache_xhit++;
+	    hash->lastbucket= -1;
+	    return b * BUCKET_WAYS + w;
 	}
-	if (VH) printf("H:   slot %d - no match\n", index);
-
-	/* find index of next slot */
-	index= (index + offset) % hash->nslots;
+    nope:
+	if (VH) printf("H:   entry %d - no match\n", w);
     }
+    hash->lastway= -1;
     return -1;
 }
 
 
+/* BYPASS_CACHE - Return true if the cache should not be used for line i in
+ * direction k this time, because it has not been getting hits.  In that
+ * case, the line should neither be looked up nor added.
+ */
+
+int bypass_cache(dir_t k, line_t i)
+{
+    LineStat *s= &lstat[k][i];
+
+    if (s->skip == 0) return 0;
+    s->skip--;
+    s->bypass++;
+    cache_bypass++;
+    return 1;
+}
+
+
+/* SAMPLE_LINE - Count a lookup of line i in direction k, and if that ends a
+ * sample with too few hits, start bypassing the cache for that line.
+ */
+
+static void sample_line(dir_t k, line_t i, int hit)
+{
+    LineStat *s= &lstat[k][i];
+
+    s->req++;
+    s->sreq++;
+    if (hit)
+    {
+	s->hit++;
+	s->shit++;
+    }
+    if (s->sreq >= CACHE_SAMPLE)
+    {
+	if (s->shit < CACHE_MINHITS)
+	    s->skip= CACHE_BYPASS;
+	s->sreq= s->shit= 0;
+    }
+}
+
+
+/* DUMP_CACHE_STATS - Print the lookup statistics for each line. */
+
+void dump_cache_stats(FILE *fp, Puzzle *puz)
+{
+    dir_t k;
+    line_t i;
+    LineStat *s;
+
+    if (lstat[D_ROW] == NULL) return;
+
+    fprintf(fp,"H: Line cache statistics:\n");
+    for (k= 0; k < 2; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    s= &lstat[k][i];
+	    fprintf(fp,"H:   %s %d: clueid=%d lookups=%ld hits=%ld (%.1f%%) "
+		    "bypassed=%ld%s\n",
+		cluename(puz->type,k), i, clid[k][i], s->req, s->hit,
+		(float)(s->req ? s->hit*100.0/s->req : 0), s->bypass,
+		s->skip ? " (bypassing)" : "");
+	}
+}
+
+
 /* LINE_CACHE - Check if there is a cached solution for the given line.  If
  * so return a solution for it as an array of bitstrings.  If not, return
  * NULL.
@@ -346,22 +991,20 @@ int hash_find(LineHash *hash, line_t clid, bit_type *line)
 
 bit_type *line_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 {
-    int index;
+    long index;
     HashElem *e;
+    bit_type *new;
     line_t this_clid= clid[k][i];
     line_t ncell= puz->clue[k][i].linelen;
 
     if (VH) printf("H: checking cache for %s %i\n", cluename(puz->type,k),i);
 
-    cache[k]->lastslot= -1;
+    cache[k]->lastbucket= -1;
 
-    /* Get the line length if it wasn't passed to us */
-
-    /* Compress the current state of the line */
-    if (this_clid > 0)
-	compress_line(puz, sol, k, i, ncell, tmp);
-    else
-	rev_compress_line(puz, sol, k, i, ncell, tmp);
+    /* Get the compressed state of the line.  We need our own copy as the
+     * key for add_cache(), since the line will have changed by then. */
+    if (!packready) pack_lines(puz, sol);
+    memmove(tmp, packed(k,i), cache[k]->len * sizeof(bit_type));
     if (VH)
     {
 	printf("H: clueid=%d compressed line: ",this_clid);
@@ -369,25 +1012,33 @@ bit_type *line_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
     }
 
     /* Look for a match in the hash table */
-    index= hash_find(cache[k], abs(this_clid), tmp);
-
-    if (index < 0)
-      	/* Table is full - should never happen */
-	return NULL;
+    index= hash_find(cache[k], abs(this_clid), tmp,
+	    clue_hash(abs(this_clid), sig[k][i]));
 
-    e= HashSlot(cache[k], index);
-    if (clueid(e) == 0)
+    if (index >= 0)
+	new= newstate(cache[k], HashSlot(cache[k], index));
+    else
     {
-       	/* No matching table entry found */
-	cache[k]->lastslot= index;
-	return NULL;
+       	/* No matching table entry found.  Try the persistent store, and if
+	 * it's there, copy it into the cache */
+	if (!storelines ||
+		(new= find_store(k, i, tmp, cache[k]->len)) == NULL)
+	{
+	    sample_line(k, i, 0);
+	    return NULL;
+	}
+	if ((e= new_entry(puz, k, i)) != NULL)
+	    memmove(newstate(cache[k],e), new,
+		    cache[k]->len * sizeof(bit_type));
+	cache[k]->lastbucket= -1;
     }
+    sample_line(k, i, 1);
 
     /* Uncompress the solution */
     if (this_clid > 0)
-	uncompress_line(newstate(cache[k],e), ncell, puz->ncolor, col);
+	uncompress_line(new, ncell, puz->ncolor, col);
     else
-	rev_uncompress_line(newstate(cache[k],e), ncell, puz->ncolor, col);
+	rev_uncompress_line(new, ncell, puz->ncolor, col);
     if (VH)
     {
 	printf("H: uncompressed solution:\n");
@@ -399,9 +1050,63 @@ bit_type *line_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 }
 
 
+/* NEW_ENTRY:  Make a new entry in the cache for line i in direction k,
+ * whose compressed state is in tmp, in the bucket where the most recent call
+ * to line_cache() looked for it.  Returns the entry, with the key filled in
+ * but not the value.  If there was no previous search, returns NULL.
+ */
+
+HashElem *new_entry(Puzzle *puz, dir_t k, line_t i)
+{
+    /* If no previous search, silently do nothing */
+    if (cache[k]->lastbucket < 0) return NULL;
+
+    return insert_entry(cache[k], abs(clid[k][i]), tmp);
+}
+
+
+/* INSERT_ENTRY:  Make a new entry in table h for the given clue id and
+ * compressed line state, in the bucket h->lastbucket, whose hash value is
+ * h->lastv and whose first free way is h->lastway.  Returns the entry, with
+ * the key filled in but not the value.
+ */
+
+static HashElem *insert_entry(LineHash *h, line_t id, bit_type *state)
+{
+    HashElem *e;
+
+    /* If the bucket is full, or the table is getting full, grow the table
+     * if we can, and find the bucket again, since it will have moved */
+    while (((h->lastway < 0 && h->n >= h->growat) || h->n >= h->flushat) &&
+	    h->nbucket < h->maxbucket)
+    {
+	if (VH) printf("H: Growing cache\n");
+	grow_hash(h);
+	h->lastbucket= h->lastv & (h->nbucket - 1);
+	h->lastway= free_way(h, h->lastbucket);
+    }
+
+    /* If the bucket is still full, make room by evicting something */
+    if (h->lastway < 0)
+	h->lastway= evict_one(h, h->lastbucket);
+    else
+	h->n++;
+
+    cache_add++;
+
+    h->bucket[h->lastbucket].fp[h->lastway]= fingerprint(h->lastv);
+    e= BucketSlot(h, h->lastbucket, h->lastway);
+    clueid(e)= id;
+    e->ref= 1;
+    e->puzzle= puzzleno;
+    memmove(oldstate(e), state, h->len * sizeof(bit_type));
+    return e;
+}
+
+
 /* ADD_CACHE:  If a call to line_cache() fails, and we compute a solution
- * the hard way, then call this to add it to the cache.  It will be stored
- * in the empty cell where the most recent call to line_cache() stopped.
+ * the hard way, then call this to add it to the cache, and to the
+ * persistent store if we have one.
  */
 
 void add_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
@@ -412,40 +1117,507 @@ void add_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
     if (VH) printf("H: adding %s %i solution to cache %d\n",
 		cluename(puz->type,k),i,k);
 
-    /* Empty the cache if it is too full */
-    if (cache[k]->n > cache[k]->flushat)
-    {
-	if (VH) printf("H: Flushing cache %d\n",k);
-	empty_hash(cache[k]);
-	/* Redo the find so lastslot will point to the right place */
-	hash_find(cache[k], clid[k][i], tmp);
-    }
-    
-    /* If no previous search, silently do nothing */
-    if (cache[k]->lastslot < 0) return;
-    cache_add++;
-
+    if ((e= new_entry(puz, k, i)) == NULL) return;
 
-    e= HashSlot(cache[k], cache[k]->lastslot);
-    clueid(e)= abs(clid[k][i]);
-    memmove(oldstate(e), tmp, cache[k]->len * sizeof(bit_type));
-    if (clid[k][i] > 0)
-	compress_line(puz, sol, k, i, ncell, newstate(cache[k],e));
-    else
-	rev_compress_line(puz, sol, k, i, ncell, newstate(cache[k],e));
+    memmove(newstate(cache[k],e), packed(k,i),
+	    cache[k]->len * sizeof(bit_type));
     if (VH)
     {
-	printf("H: added in slot %d:\n", cache[k]->lastslot);
+	printf("H: added in bucket %ld entry %d:\n", cache[k]->lastbucket,
+		cache[k]->lastway);
 	printf("   clue id:  %d\n", clueid(e));
 	printf("   old state:  ");
 	dump_comp(oldstate(e), ncell, puz->ncolor);
 	printf("   new state:  ");
 	dump_comp(newstate(cache[k],e), ncell, puz->ncolor);
     }
-    cache[k]->n++;
+
+    if (storelines)
+	add_store(k, i, oldstate(e), newstate(cache[k],e), cache[k]->len);
+}
+
+
+/* SEGMENTED LINES - In the middle of a search, a line often has stretches
+ * that no block can reach any more, which split it into segments that can be
+ * solved separately.  Then if the whole line misses in the cache, we look up
+ * each segment, keyed by the blocks in it and its state, so a segment can hit
+ * the cache wherever the same segment turned up before, in this line or any
+ * other.
+ *
+ * To find the segments, we use the left-most and right-most solutions last
+ * saved by the line solver in clue->lpos and clue->rpos.  Those were found
+ * for an earlier state of the line, but since cells have only been narrowed
+ * since then, block b still can't start left of lpos[b] or end right of
+ * rpos[b], even if the saved solutions have been marked invalid.  If there
+ * is a cell between rpos[b] and lpos[b+1], then blocks up to b and blocks
+ * after b can't interact, and the line splits there.  Each segment runs from
+ * the first cell its first block can reach to the last cell its last block
+ * can reach, trimmed of any solved background cells at its ends, and its
+ * clue id is that of its blocks on a line the length of the segment.  Cells
+ * in no segment must be background.
+ *
+ * If every segment hits, that gives the solution of the whole line.  If any
+ * misses, the whole line is solved as usual, and then the segments that
+ * missed are added to the cache from the solved line, since the solution of
+ * a segment is just the solution of the line restricted to that segment.
+ *
+ * This is only done for two color puzzles without blotted clues, and only
+ * if it was asked for with -aD.  Splitting lines and storing the segments
+ * usually costs more than the extra hits save, and the segments fill up the
+ * cache faster.
+ */
+
+long cache_seglines= 0;	/* Lines looked up by segments */
+long cache_segs= 0;	/* Segments looked up */
+
+
+/* COMPRESS_SEG:  Compress cells lo through hi-1 of a line of a two color
+ * puzzle, reversed if rev is true, into len words.
+ */
+
+static void compress_seg(Cell **cell, line_t lo, line_t hi, int rev,
+	int len, bit_type *out)
+{
+    line_t j, n= hi - lo;
+    int bi, bn;
+    bit_type x;
+
+    for (bi= 0, j= 0; j < n; bi++)
+    {
+	for (x= 0, bn= _bit_intsiz - 2; bn >= 0 && j < n; bn-= 2, j++)
+	    x|= cell[rev ? hi - 1 - j : lo + j]->bit[0] << bn;
+	out[bi]= x;
+    }
+    for (; bi < len; bi++)
+	out[bi]= 0;
 }
 
 
+/* UNCOMPRESS_SEG:  Unpack a compressed segment into cells lo through hi-1
+ * of the col array, reversing it if rev is true.
+ */
+
+static void uncompress_seg(bit_type *in, line_t lo, line_t hi, int rev)
+{
+    line_t j, n= hi - lo;
+    int bi, bn;
+    bit_type x;
+
+    for (bi= 0, j= 0; j < n; bi++)
+	for (x= in[bi], bn= _bit_intsiz - 2; bn >= 0 && j < n; bn-= 2, j++)
+	    colbit(rev ? hi - 1 - j : lo + j)[0]= (x >> bn) & 3;
+}
+
+
+/* SPLIT_LINE:  Try to split line i in direction k into segments, as
+ * described above.  Returns the number of segments, or zero if the line
+ * doesn't split into at least two.
+ */
+
+int split_line(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t *lp= clue->lpos, *rp= clue->rpos;
+    line_t b, b0, lo, hi;
+    int s;
+
+    nseg= 0;
+    if (puz->ncolor != 2 || clue->lbcl != NULL || clue->n < 2 ||
+	    clue->lstamp == MAXLINE || clue->rstamp == MAXLINE)
+	return 0;
+
+    for (b= 0; b < clue->n; b++)
+    {
+	/* Take blocks until we come to one that can't reach the next */
+	for (b0= b; b < clue->n - 1 && rp[b] + 1 >= lp[b+1]; b++)
+	    ;
+	if (b0 == 0 && b == clue->n - 1) return 0;
+
+	lo= lp[b0];
+	hi= rp[b] + 1;
+	while (lo < hi && cell[lo]->n == 1 && may_be_bg(cell[lo])) lo++;
+	while (hi > lo && cell[hi-1]->n == 1 && may_be_bg(cell[hi-1])) hi--;
+	if (lo == hi) return nseg= 0;	/* Contradiction - let solver see it */
+
+	seg[nseg].lo= lo;
+	seg[nseg].hi= hi;
+	seg[nseg].b0= b0;
+	seg[nseg].b1= b + 1;
+	nseg++;
+    }
+
+    for (s= 0; s < nseg; s++)
+	if ((seg[s].clid= register_blocks(seg[s].b1 - seg[s].b0,
+		clue->length + seg[s].b0, clue->color + seg[s].b0,
+		seg[s].hi - seg[s].lo, puz->ncolor)) == 0)
+	    return nseg= 0;	/* Out of clue ids */
+
+    return nseg;
+}
+
+
+/* SEGMENT_CACHE - Look up each segment of the line last split by
+ * split_line().  This is done after line_cache() has failed to find the
+ * whole line, and leaves the table set up for add_cache() to add it.  If all
+ * the segments are found, return the solution of the line as an array of
+ * bitstrings.  If not, return NULL.
+ */
+
+bit_type *segment_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Cell **cell= sol->line[k][i];
+    line_t ncell= puz->clue[k][i].linelen;
+    LineHash *h= cache[k];
+    long lastbucket= h->lastbucket;
+    int lastway= h->lastway;
+    bit_type lastv= h->lastv;
+    line_t j, id;
+    long index;
+    int s, nmiss= 0;
+
+    if (VH) printf("H: checking cache for %s %i in %d segments\n",
+	    cluename(puz->type,k), i, nseg);
+
+    /* Cells outside the segments are background */
+    for (s= 0, j= 0; j < ncell; j++)
+    {
+	if (s < nseg && j == seg[s].lo)
+	{
+	    j= seg[s++].hi - 1;
+	    continue;
+	}
+	if (!may_be_bg(cell[j])) return NULL;
+	fbit_setonly(colbit(j), BGCOLOR);
+    }
+
+    for (s= 0; s < nseg; s++)
+    {
+	id= abs(seg[s].clid);
+	compress_seg(cell, seg[s].lo, seg[s].hi, seg[s].clid < 0, h->len,
+		segstate(s));
+	seg[s].v= hash_index(id, segstate(s), h->len);
+	if (VH)
+	{
+	    printf("H: segment %d cells %d-%d blocks %d-%d clueid=%d: ", s,
+		seg[s].lo, seg[s].hi - 1, seg[s].b0, seg[s].b1 - 1,
+		seg[s].clid);
+	    dump_comp(segstate(s), seg[s].hi - seg[s].lo, puz->ncolor);
+	}
+	index= hash_find(h, id, segstate(s), seg[s].v);
+	seg[s].hit= (index >= 0);
+	if (seg[s].hit)
+	    uncompress_seg(newstate(h, HashSlot(h, index)),
+		    seg[s].lo, seg[s].hi, seg[s].clid < 0);
+	else
+	    nmiss++;
+    }
+    h->lastbucket= lastbucket;
+    h->lastway= lastway;
+    h->lastv= lastv;
+
+    cache_seglines++;
+    cache_segs+= nseg;
+
+    if (nmiss > 0) return NULL;
+
+    /* line_cache() counted this as a miss for the line */
+    lstat[k][i].hit++;
+    lstat[k][i].shit++;
+
+    if (VH)
+    {
+	printf("H: uncompressed solution:\n");
+	dump_lro_solve(puz, k, i, col);
+    }
+    return col;
+}
+
+
+/* ADD_SEGMENTS - If a call to segment_cache() fails, and we solve the line
+ * the hard way, then call this to add the segments that weren't found to
+ * the cache.
+ */
+
+void add_segments(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Cell **cell= sol->line[k][i];
+    LineHash *h= cache[k];
+    HashElem *e;
+    int s, t;
+
+    for (s= 0; s < nseg; s++)
+    {
+	if (seg[s].hit) continue;
+
+	/* The same segment may turn up twice in a line */
+	for (t= 0; t < s; t++)
+	    if (!seg[t].hit && seg[t].clid == seg[s].clid &&
+		    !memcmp(segstate(t), segstate(s), h->len*sizeof(bit_type)))
+		break;
+	if (t < s) continue;
+
+	/* Find the bucket it goes in again, since adding the earlier
+	 * segments may have changed the table */
+	h->lastv= seg[s].v;
+	h->lastbucket= seg[s].v & (h->nbucket - 1);
+	h->lastway= free_way(h, h->lastbucket);
+
+	if (VH) printf("H: adding %s %i segment %d to cache\n",
+		cluename(puz->type,k), i, s);
+	e= insert_entry(h, abs(seg[s].clid), segstate(s));
+	compress_seg(cell, seg[s].lo, seg[s].hi, seg[s].clid < 0, h->len,
+		newstate(h,e));
+    }
+    h->lastbucket= -1;
+}
+
+
+/* FEASIBILITY CACHE - This remembers whether each line state that
+ * line_feasible() has been asked about has a solution.  It is keyed by clue
+ * id and compressed line state, like the line cache.  Along with the verdict,
+ * it keeps the block positions of one solution, when we have them, since the
+ * exhaustive search wants those too.  It is turned on at the start of the
+ * solve if we are doing contradiction testing or exhaustive checking, which
+ * ask about the same line states over and over.
+ *
+ * Positions are kept in the orientation of the compressed state, so lines
+ * with negative clue ids have theirs reversed on the way in and out.
+ *
+ * The table is a fixed number of sets of FEAS_WAYS entries each.  Each line
+ * state can only go in the set picked by its hash.  If the set is full, the
+ * new entry replaces one of the old ones, taking turns.
+ */
+
+typedef struct {
+    line_t clid;	/* Clue ID.  Zero if this entry is unused */
+    char ok;		/* One if the line is feasible, zero if not */
+    char haspos;	/* One if the block positions are saved */
+    bit_type state[1];	/* The line state.  Actual length is feaslen */
+    /* Followed by feasmaxn block positions and feasmaxn block lengths */
+} FeasElem;
+
+#define FEAS_WAYS 4
+
+static char *feas= NULL;	/* The table */
+static int feaslen;		/* Longest line state in words */
+static int feasesize;		/* Element size in bytes */
+static int feaspoff;		/* Offset of block positions in an element */
+static line_t feasmaxn;		/* Most blocks in any clue */
+static long feasmask;		/* Number of sets minus one */
+static long feasset;		/* Set searched by the last find_feas() */
+static int feasway;		/* Way matched by the last find_feas(), or -1 */
+static int feashand;		/* Next way to replace in a full set */
+static line_t *feaspos, *feasbcl;	/* Positions returned by find_feas() */
+
+#define FeasSlot(s,w) ((FeasElem *)(feas + ((s)*FEAS_WAYS + (w))*feasesize))
+#define FeasPos(e) ((line_t *)((char *)(e) + feaspoff))
+#define FeasBcl(e) (FeasPos(e) + feasmaxn)
+
+long feas_hit= 0;
+
+
+/* INIT_FEAS: Construct the feasibility cache for a puzzle. */
+
+void init_feas(Puzzle *puz)
+{
+    long nset, size;
+    line_t i;
+    dir_t k;
+
+    if (puz->type != PT_GRID) return;
+
+    init_pack(puz);
+    feaslen= (packlen[0] > packlen[1]) ? packlen[0] : packlen[1];
+    feasmaxn= 1;
+    for (k= 0; k < puz->nset; k++)
+	for (i= 0; i < puz->n[k]; i++)
+	    if (puz->clue[k][i].n > feasmaxn) feasmaxn= puz->clue[k][i].n;
+
+    feaspoff= sizeof(FeasElem) + (feaslen - 1) * sizeof(bit_type);
+    feasesize= feaspoff + 2 * feasmaxn * sizeof(line_t);
+    feasesize= (feasesize + sizeof(bit_type) - 1) & ~(sizeof(bit_type) - 1);
+    /* Zeroing a big table costs more than small puzzles will save */
+    size= FEAS_CELLSLOTS * puz->n[D_ROW] * puz->n[D_COL];
+    if (size > FEAS_SLOTS) size= FEAS_SLOTS;
+    for (nset= 1; nset * FEAS_WAYS < size; nset*= 2)
+	;
+    feasmask= nset - 1;
+    feas= (char *)calloc(nset * FEAS_WAYS, feasesize);
+    feashand= 0;
+    feaspos= (line_t *)malloc((feasmaxn + 1) * sizeof(line_t));
+    feasbcl= (line_t *)malloc(feasmaxn * sizeof(line_t));
+
+    if (VH) printf("H: Feasibility cache has %ld slots\n", nset * FEAS_WAYS);
+}
+
+
+/* FIND_FEAS: Look up line i in direction k in the feasibility cache.  Return
+ * 1 if it is known to be feasible, 0 if it is known not to be, and -1 if we
+ * don't know.  If ppos is not NULL, then we only return 1 if we also have a
+ * solution to give back in *ppos and *pbcl, as line_feasible() does.  After
+ * a -1, the caller should work out the answer and pass it to add_feas().
+ */
+
+int find_feas(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	line_t **ppos, line_t **pbcl)
+{
+    line_t c, b, n, *pos, *bcl;
+    FeasElem *e;
+    int w;
+
+    feasway= -1;
+    if (feas == NULL) return -1;
+    if (!packready) pack_lines(puz, sol);
+
+    c= abs(clid[k][i]);
+
+    feasset= clue_hash(c, sig[k][i]) & feasmask;
+    for (w= 0; w < FEAS_WAYS; w++)
+    {
+	e= FeasSlot(feasset, w);
+	if (e->clid == c &&
+	    !memcmp(e->state, packed(k,i), packlen[k] * sizeof(bit_type)))
+	    break;
+    }
+    if (w == FEAS_WAYS) return -1;
+
+    if (e->ok && ppos != NULL)
+    {
+	if (!e->haspos)
+	{
+	    feasway= w;
+	    return -1;
+	}
+	n= puz->clue[k][i].n;
+	pos= FeasPos(e);
+	bcl= FeasBcl(e);
+	if (clid[k][i] > 0)
+	    for (b= 0; b < n; b++)
+	    {
+		feaspos[b]= pos[b];
+		feasbcl[b]= bcl[b];
+	    }
+	else
+	    for (b= 0; b < n; b++)
+	    {
+		feasbcl[b]= bcl[n-1-b];
+		feaspos[b]= puz->clue[k][i].linelen - pos[n-1-b] - feasbcl[b];
+	    }
+	feaspos[n]= -1;
+	*ppos= feaspos;
+	*pbcl= feasbcl;
+    }
+    feas_hit++;
+    return e->ok;
+}
+
+
+/* ADD_FEAS: Store the verdict on line i in direction k, after find_feas()
+ * failed to find it.  If the line is feasible, pos and bcl may give the
+ * solution found, or may be NULL.
+ */
+
+void add_feas(Puzzle *puz, dir_t k, line_t i, int ok, line_t *pos,
+	line_t *bcl)
+{
+    line_t b, n;
+    FeasElem *e;
+    int w;
+
+    if (feas == NULL) return;
+
+    if ((w= feasway) < 0)
+    {
+	for (w= 0; w < FEAS_WAYS; w++)
+	    if (FeasSlot(feasset, w)->clid == 0) break;
+	if (w == FEAS_WAYS)
+	{
+	    w= feashand;
+	    feashand= (feashand + 1) % FEAS_WAYS;
+	}
+    }
+
+    e= FeasSlot(feasset, w);
+    e->clid= abs(clid[k][i]);
+    e->ok= ok;
+    memmove(e->state, packed(k,i), packlen[k] * sizeof(bit_type));
+
+    e->haspos= (ok && pos != NULL);
+    if (e->haspos)
+    {
+	n= puz->clue[k][i].n;
+	if (clid[k][i] > 0)
+	    for (b= 0; b < n; b++)
+	    {
+		FeasPos(e)[b]= pos[b];
+		FeasBcl(e)[b]= bcl[b];
+	    }
+	else
+	    for (b= 0; b < n; b++)
+	    {
+		FeasBcl(e)[b]= bcl[n-1-b];
+		FeasPos(e)[b]= puz->clue[k][i].linelen - pos[n-1-b] - bcl[n-1-b];
+	    }
+    }
+}
+
+
+/* RELEASE_CACHE: Free everything the caches keep about the current puzzle,
+ * when we are done with it.  The cache tables and clue ids are kept for the
+ * next puzzle.
+ */
+
+void release_cache(void)
+{
+    dir_t k;
+
+    for (k= 0; k < 2; k++)
+    {
+	free(clid[k]);
+	clid[k]= NULL;
+	free(pack[k]);
+	pack[k]= NULL;
+	free(sig[k]);
+	cache[k]= NULL;
+	free(lstat[k]);
+	lstat[k]= NULL;
+    }
+    packready= 0;
+
+    free(tmp);
+    tmp= NULL;
+    free(col);
+    col= NULL;
+    free(seg);
+    seg= NULL;
+    free(segkey);
+    segkey= NULL;
+
+    if (feas != NULL)
+    {
+	free(feas);
+	feas= NULL;
+	free(feaspos);
+	free(feasbcl);
+    }
+}
+
+
+/* WHOLE_CELLS: True if the cells of a compressed line never straddle a word
+ * boundary, which happens when the number of colors divides the word size,
+ * as it does for all two color puzzles.  Then we can pack and unpack a word
+ * at a time, with a fixed shift for each cell, instead of working out for
+ * each cell whether it needs to be split.
+ */
+
+#define WHOLE_CELLS(ncolor) (fbit_size == 1 && _bit_intsiz % (ncolor) == 0)
+
+/* Since WHOLE_CELLS lines have one word per cell, col can be indexed
+ * directly in those loops.
+ */
+
+
 /* COMPRESS_LINE: Take a line of the current solution and compress it into
  * a single bit string.  The string will contain <ncell>*<ncolors> bits,
  * each bit being one if that cell can be that color.  "out" must point to a
@@ -459,44 +1631,45 @@ void compress_line(Puzzle *puz, Solution *sol,
     Cell **cell= sol->line[k][i];
     int bi= 0;            /* Currently storing into out[i] */
     int bn= _bit_intsiz;  /* First free bit in out[i] */
+    bit_type x;
+    int nl= puz->ncolor - (fbit_size-1)*_bit_intsiz;	/* bits in last word */
 
     out[bi]= 0;
 
-#ifdef LIMITCOLORS
-    z= 0;
-#endif
+    if (WHOLE_CELLS(puz->ncolor))
+    {
+	m= puz->ncolor;
+	for (j= 0; j < ncell; bi++)
+	{
+	    for (x= 0, bn= _bit_intsiz - m; bn >= 0 && j < ncell; bn-= m)
+		x|= cell[j++]->bit[0] << bn;
+	    out[bi]= x;
+	}
+	return;
+    }
 
     for (j= 0; j < ncell; j++)
     {
-#ifdef LIMITCOLORS
-	m= puz->ncolor;
-#else
-	for (z= 0; z < fbit_size; i++)
+	for (z= 0; z < fbit_size; z++)
 	{
 	    /* number of bits we want from cell[j]->bit[z] */
-	    m= (z == fbit_size-1) ? puz->ncolor % _bit_intsize : _bit_intsize;
+	    m= (z == fbit_size-1) ? nl : _bit_intsiz;
 
-#endif
 	    if (m > bn)
 	    {
-		out[bi]|= cell[j]->bit[z] >> (m - bn);
+		if (bn > 0) out[bi]|= cell[j]->bit[z] >> (m - bn);
 		m-= bn;
 		out[++bi]= 0;
 		bn= _bit_intsiz;
 	    }
-	    if (m > 0 && m <= bn)
+	    out[bi]|= cell[j]->bit[z] << (bn - m);
+	    bn-= m;
+	    if (bn == 0 && j < ncell-1 && z == fbit_size-1)
 	    {
-		out[bi]|= cell[j]->bit[z] << (bn - m);
-		bn-= m;
-		if (bn == 0)
-		{
-		    out[++bi]= 0;
-		    bn= _bit_intsiz;
-		}
+		out[++bi]= 0;
+		bn= _bit_intsiz;
 	    }
-#ifndef LIMITCOLORS
 	}
-#endif
     }
 }
 
@@ -514,58 +1687,79 @@ void rev_compress_line(Puzzle *puz, Solution *sol,
     Cell **cell= sol->line[k][i];
     int bi= 0;            /* Currently storing into out[i] */
     int bn= _bit_intsiz;  /* First free bit in out[i] */
+    bit_type x;
+    int nl= puz->ncolor - (fbit_size-1)*_bit_intsiz;	/* bits in last word */
 
     out[bi]= 0;
 
-#ifdef LIMITCOLORS
-    z= 0;
-#endif
+    if (WHOLE_CELLS(puz->ncolor))
+    {
+	m= puz->ncolor;
+	for (j= ncell-1; j >= 0; bi++)
+	{
+	    for (x= 0, bn= _bit_intsiz - m; bn >= 0 && j >= 0; bn-= m)
+		x|= cell[j--]->bit[0] << bn;
+	    out[bi]= x;
+	}
+	return;
+    }
 
     for (j= ncell-1; j >= 0; j--)
     {
-#ifdef LIMITCOLORS
-	m= puz->ncolor;
-#else
-	for (z= 0; z < fbit_size; i++)
+	for (z= 0; z < fbit_size; z++)
 	{
 	    /* number of bits we want from cell[j]->bit[z] */
-	    m= (z == fbit_size-1) ? puz->ncolor % _bit_intsize : _bit_intsize;
+	    m= (z == fbit_size-1) ? nl : _bit_intsiz;
 
-#endif
 	    if (m > bn)
 	    {
-		out[bi]|= cell[j]->bit[z] >> (m - bn);
+		if (bn > 0) out[bi]|= cell[j]->bit[z] >> (m - bn);
 		m-= bn;
 		out[++bi]= 0;
 		bn= _bit_intsiz;
 	    }
-	    if (m > 0 && m <= bn)
+	    out[bi]|= cell[j]->bit[z] << (bn - m);
+	    bn-= m;
+	    if (bn == 0 && j > 0 && z == fbit_size-1)
 	    {
-		out[bi]|= cell[j]->bit[z] << (bn - m);
-		bn-= m;
-		if (bn == 0)
-		{
-		    out[++bi]= 0;
-		    bn= _bit_intsiz;
-		}
+		out[++bi]= 0;
+		bn= _bit_intsiz;
 	    }
-#ifndef LIMITCOLORS
 	}
-#endif
     }
 }
 
 
+/* UNCOMPRESS_LINE: Unpack a compressed line into the col array, one bit
+ * string per cell.
+ */
+
 void uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out)
 {
     int i,z;
-    bit_type *b;
+    bit_type *b, x, m;
     int bi= 0;
     int bn= _bit_intsiz;
+    int nl= ncolor - (fbit_size-1)*_bit_intsiz;	/* bits in last word */
+
+    if (WHOLE_CELLS(ncolor))
+    {
+	m= bit_zeroone(ncolor);
+	for (i= 0; i < ncell; bi++)
+	    for (x= in[bi], bn= _bit_intsiz - ncolor; bn >= 0 && i < ncell;
+		    bn-= ncolor)
+		col[i++]= (x >> bn) & m;
+	return;
+    }
 
     for (i= 0; i < ncell; i++)
     {
 	b= colbit(i);
+	if (bn == 0)
+	{
+	    bi++;
+	    bn= _bit_intsiz;
+	}
 	for (z= 0; z < fbit_size - 1; z++)
 	{
 	    if (bn == _bit_intsiz)
@@ -580,32 +1774,51 @@ void uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out)
 		b[z]|= in[bi] >> bn;
 	    }
 	}
-	if (ncolor <= bn)
+	if (nl <= bn)
 	{
-	    b[z]= (in[bi] >> (bn - ncolor)) & bit_zeroone(ncolor);
-	    bn-= ncolor;
+	    b[z]= (in[bi] >> (bn - nl)) & bit_zeroone(nl);
+	    bn-= nl;
 	}
 	else
 	{
-	    b[z]= ((in[bi] << (ncolor - bn)) |
-		   (in[++bi] >> (_bit_intsiz - ncolor + bn))
-		   & bit_zeroone(ncolor));
-	    bn+= _bit_intsiz - ncolor;
+	    x= in[bi++] << (nl - bn);
+	    b[z]= (x | (in[bi] >> (_bit_intsiz - nl + bn))) &
+		bit_zeroone(nl);
+	    bn+= _bit_intsiz - nl;
 	}
     }
 }
 
 
+/* REV_UNCOMPRESS_LINE: The same, but the cells come out in reverse order.
+ */
+
 void rev_uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out)
 {
     int i,z;
-    bit_type *b;
+    bit_type *b, x, m;
     int bi= 0;
     int bn= _bit_intsiz;
+    int nl= ncolor - (fbit_size-1)*_bit_intsiz;	/* bits in last word */
+
+    if (WHOLE_CELLS(ncolor))
+    {
+	m= bit_zeroone(ncolor);
+	for (i= ncell-1; i >= 0; bi++)
+	    for (x= in[bi], bn= _bit_intsiz - ncolor; bn >= 0 && i >= 0;
+		    bn-= ncolor)
+		col[i--]= (x >> bn) & m;
+	return;
+    }
 
     for (i= ncell-1; i >= 0; i--)
     {
 	b= colbit(i);
+	if (bn == 0)
+	{
+	    bi++;
+	    bn= _bit_intsiz;
+	}
 	for (z= 0; z < fbit_size - 1; z++)
 	{
 	    if (bn == _bit_intsiz)
@@ -620,17 +1833,17 @@ void rev_uncompress_line(bit_type *in, int ncell, int ncolor, bit_type *out)
 		b[z]|= in[bi] >> bn;
 	    }
 	}
-	if (ncolor <= bn)
+	if (nl <= bn)
 	{
-	    b[z]= (in[bi] >> (bn - ncolor)) & bit_zeroone(ncolor);
-	    bn-= ncolor;
+	    b[z]= (in[bi] >> (bn - nl)) & bit_zeroone(nl);
+	    bn-= nl;
 	}
 	else
 	{
-	    b[z]= ((in[bi] << (ncolor - bn)) |
-		   (in[++bi] >> (_bit_intsiz - ncolor + bn))
-		   & bit_zeroone(ncolor));
-	    bn+= _bit_intsiz - ncolor;
+	    x= in[bi++] << (nl - bn);
+	    b[z]= (x | (in[bi] >> (_bit_intsiz - nl + bn))) &
+		bit_zeroone(nl);
+	    bn+= _bit_intsiz - nl;
 	}
     }
 }
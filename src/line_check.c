@@ -0,0 +1,322 @@
+/* Copyright 2012 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* LINE FEASIBILITY CHECK - Sometimes we only want to know if a line still
+ * has any solution at all, and don't care where the blocks go.  We could run
+ * left_solve() and throw away the positions, but that does a lot of work we
+ * don't need.  Instead we treat the clue as a regular expression over the
+ * colors of the cells and run a nondeterministic finite automaton for it
+ * down the line, simulating all its states at once with bit operations.
+ *
+ * The automaton has one state for each cell of each block, one for the
+ * background gap after each block, and one for the background before the
+ * first block.  State s is set in the state vector if some way of coloring
+ * the cells read so far leaves the automaton in state s.  The gap states
+ * loop on themselves.  Each step takes every state to the one after it, and
+ * a gap between two blocks of different colors, or the gap at the end of the
+ * line, may be skipped over entirely.  The result is masked by the states
+ * that accept the colors the current cell may be.  The line has a solution if
+ * the state vector after the last cell includes the last cell of the last
+ * block, or the final gap.
+ *
+ * This takes one pass over the line with a few word operations per cell, and
+ * no backtracking.  If the caller wants a solution too, we save the state
+ * vector after each cell, and trace a path through them back from the end.
+ * Clues with blots are not handled.  For those we just call left_solve().
+ */
+
+#include "pbnsolve.h"
+
+#define NFA_BITS _bit_intsiz
+
+/* State vectors may be more than one word long.  These are bit_set() and
+ * bit_test() as expressions, so they can be used inside conditions.
+ */
+#define nfa_set(v,s) ((v)[_bit_intn(s)]|= _bit_mask(s))
+#define nfa_test(v,s) ((v)[_bit_intn(s)] & _bit_mask(s))
+
+/* The automaton for each clue is built once, by init_check(), and kept in
+ * clue->nfa, which holds nw words each for:
+ *
+ *   loop     - gap states, which loop on themselves.
+ *   skip     - states from which we can skip over the following gap.
+ *   cmask(c) - states that accept a cell of color c, for each color c.
+ *
+ * where nw is the number of words needed for clue->nfastate states.  Blotted
+ * clues don't get an automaton.
+ */
+
+#define nfa_loop(a) (a)
+#define nfa_skip(a,nw) ((a)+(nw))
+#define nfa_cmask(a,nw,c) ((a)+(2+(c))*(nw))
+
+/* Work arrays, sized for the largest automaton and line in the puzzle.
+ *
+ *   nfa_d    - state vector, one step ahead.
+ *   nfa_cell - states that accept the current cell, and then the states we
+ *              are in after it.
+ *   nfa_hist - copies of nfa_cell for each cell of the line.
+ *   nfa_pos  - block positions of the solution found by the traceback.
+ */
+
+static bit_type *nfa_d, *nfa_cell, *nfa_hist;
+static line_t *nfa_pos;
+static int nfa_maxword;
+
+#define hist(j) (nfa_hist + (j)*nfa_maxword)
+
+long feas_runs, feas_fails;
+
+
+/* INIT_CHECK - Build the automata for all the clues in the puzzle, and
+ * allocate the work arrays for the feasibility check.
+ */
+
+void init_check(Puzzle *puz)
+{
+    Clue *clue;
+    bit_type *a;
+    int nstate, nw, s;
+    line_t i, b, l, maxcluelen= 0, maxdimension= 0;
+    dir_t k;
+
+    nfa_maxword= 1;
+    for (k= 0; k < puz->nset; k++)
+    {
+	if (puz->n[k] > maxdimension) maxdimension= puz->n[k];
+	for (i= 0; i < puz->n[k]; i++)
+	{
+	    clue= &puz->clue[k][i];
+	    clue->nfa= NULL;
+	    if (clue->n > maxcluelen) maxcluelen= clue->n;
+
+	    nstate= 1;
+	    for (b= 0; b < clue->n; b++)
+	    {
+		if (clue->length[b] == 0) break;
+		nstate+= clue->length[b] + 1;
+	    }
+	    if (b < clue->n) continue;
+
+	    clue->nfastate= nstate;
+	    nw= bit_size(nstate);
+	    if (nw > nfa_maxword) nfa_maxword= nw;
+	    clue->nfa= a= (bit_type *)calloc((2 + puz->ncolor) * nw,
+		    sizeof(bit_type));
+
+	    nfa_set(nfa_cmask(a,nw,BGCOLOR), 0);
+	    nfa_set(nfa_loop(a), 0);
+	    for (s= 1, b= 0; b < clue->n; b++)
+	    {
+		for (l= 0; l < clue->length[b]; l++, s++)
+		    nfa_set(nfa_cmask(a,nw,clue->color[b]), s);
+
+		/* The gap after the block */
+		nfa_set(nfa_cmask(a,nw,BGCOLOR), s);
+		nfa_set(nfa_loop(a), s);
+		if (b < clue->n - 1 && clue->color[b+1] != clue->color[b])
+		    nfa_set(nfa_skip(a,nw), s-1);
+		s++;
+	    }
+	}
+    }
+
+    /* Work arrays from any previous puzzle are too small or too big */
+    free(nfa_d);
+    free(nfa_cell);
+    free(nfa_hist);
+    free(nfa_pos);
+    nfa_d= (bit_type *)malloc(nfa_maxword * sizeof(bit_type));
+    nfa_cell= (bit_type *)malloc(nfa_maxword * sizeof(bit_type));
+    nfa_hist= (bit_type *)malloc(maxdimension*nfa_maxword*sizeof(bit_type));
+    nfa_pos= (line_t *)malloc((maxcluelen + 1) * sizeof(line_t));
+}
+
+
+/* RUN_FEASIBLE - Run the automaton for line i in direction k.  This does the
+ * work for line_feasible(), below.
+ */
+
+static int run_feasible(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	line_t **ppos, line_t **pbcl)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t ncell= clue->linelen;
+    line_t j, b;
+    bit_type *a= clue->nfa;
+    bit_type d, r, sk, c1, c2, *cm;
+    bit_type loop, skip, m0, m1;
+    int s, w, nw, nstate, first;
+    color_t c;
+
+    if (a == NULL)
+    {
+	/* Blotted clue */
+	line_t *pos, *bcl;
+	return !left_solve(puz, sol, k, i, 0, ppos ? ppos : &pos,
+		    ppos ? pbcl : &bcl);
+    }
+
+    nstate= clue->nfastate;
+    nw= bit_size(nstate);
+
+    if (nw == 1 && puz->ncolor == 2)
+    {
+	/* Most lines of two color puzzles fit in one word, so we do those
+	 * without any loops over words or colors.
+	 */
+	loop= *nfa_loop(a);
+	skip= *nfa_skip(a,1);
+	m0= *nfa_cmask(a,1,0);
+	m1= *nfa_cmask(a,1,1);
+	d= (clue->n > 0) ? 3 : 1;
+	for (j= 0; j < ncell; j++)
+	{
+	    r= cell[j]->bit[0];
+	    d&= ((r & 1) ? m0 : 0) | ((r & 2) ? m1 : 0);
+	    if (d == 0) return 0;
+	    *nfa_cell= d;
+	    if (ppos != NULL) *hist(j)= d;
+	    d= (d << 1) | (d & loop) | ((d & skip) << 2);
+	}
+    }
+    else
+    {
+	/* The state vector is kept one step ahead, holding the states we can
+	 * move into on the next cell.  On the first cell, that is the leading
+	 * gap or the first cell of the first block.
+	 */
+	memset(nfa_d, 0, nw * sizeof(bit_type));
+	nfa_set(nfa_d, 0);
+	if (clue->n > 0) nfa_set(nfa_d, 1);
+
+	for (j= 0; j < ncell; j++)
+	{
+	    /* Find the states that accept the current cell */
+	    if (puz->ncolor == 2)
+	    {
+		r= cell[j]->bit[0];
+		m0= (r & 1) ? _bit_1s : 0;
+		m1= (r & 2) ? _bit_1s : 0;
+		for (w= 0; w < nw; w++)
+		    nfa_cell[w]= (nfa_cmask(a,nw,0)[w] & m0) |
+			(nfa_cmask(a,nw,1)[w] & m1);
+	    }
+	    else
+	    {
+		memset(nfa_cell, 0, nw * sizeof(bit_type));
+		for (c= 0; c < puz->ncolor; c++)
+		    if (may_be(cell[j], c))
+			for (cm= nfa_cmask(a,nw,c), w= 0; w < nw; w++)
+			    nfa_cell[w]|= cm[w];
+	    }
+
+	    /* Advance the automaton */
+	    c1= c2= 0;
+	    r= 0;
+	    for (w= 0; w < nw; w++)
+	    {
+		nfa_cell[w]= d= nfa_d[w] & nfa_cell[w];
+		r|= d;
+		sk= d & nfa_skip(a,nw)[w];
+		nfa_d[w]= (d << 1) | c1 | (d & nfa_loop(a)[w]) | (sk << 2) | c2;
+		c1= d >> (NFA_BITS - 1);
+		c2= sk >> (NFA_BITS - 2);
+	    }
+	    if (r == 0) return 0;
+	    if (ppos != NULL)
+		memcpy(hist(j), nfa_cell, nw * sizeof(bit_type));
+	}
+    }
+
+    /* Accept if we ended in the last cell of the last block or in the final
+     * gap.  The states we were in after the last cell are left in nfa_cell.
+     */
+    if (ncell == 0)
+	s= (clue->n == 0) ? 0 : -1;
+    else if (nfa_test(nfa_cell, nstate - 1))
+	s= nstate - 1;
+    else if (nstate > 1 && nfa_test(nfa_cell, nstate - 2))
+	s= nstate - 2;
+    else
+	s= -1;
+    if (s < 0) return 0;
+
+    if (ppos != NULL)
+    {
+	/* Trace back a path through the saved state vectors.  Each step goes
+	 * to any state we could have come from, and each time we pass the
+	 * first state of a block we have found where that block starts.
+	 */
+	b= clue->n - 1;
+	first= nstate - 1 - (b >= 0 ? clue->length[b] : 0);
+	for (j= ncell - 1; j >= 0; j--)
+	{
+	    if (b >= 0 && s == first)
+	    {
+		nfa_pos[b--]= j;
+		if (b >= 0) first-= clue->length[b] + 1;
+	    }
+	    if (j == 0) break;
+	    if (nfa_test(nfa_loop(a), s) && nfa_test(hist(j-1), s))
+		continue;
+	    if (s >= 2 && nfa_test(nfa_skip(a,nw), s-2) &&
+		    nfa_test(hist(j-1), s-2))
+		s-= 2;
+	    else
+		s--;
+	}
+	nfa_pos[clue->n]= -1;
+	*ppos= nfa_pos;
+	*pbcl= clue->length;
+    }
+    return 1;
+}
+
+
+/* LINE_FEASIBLE - Return true if line i in direction k can still be solved,
+ * false if there is a contradiction.  If ppos is not NULL and the line can
+ * be solved, then *ppos and *pbcl are set to point to a solution, in the same
+ * form that left_solve() returns, though not necessarily the left-most one.
+ * These arrays should not be freed by the calling program.
+ *
+ * Lines that are slow to check are looked up in the feasibility cache first.
+ */
+
+int line_feasible(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	line_t **ppos, line_t **pbcl)
+{
+    Clue *clue= &puz->clue[k][i];
+    int ok;
+
+    feas_runs++;
+
+    /* A line that the automaton can do in one word is cheaper to check than
+     * to look up. */
+    if (clue->nfa != NULL && puz->ncolor == 2 && bit_size(clue->nfastate) == 1)
+	ok= run_feasible(puz, sol, k, i, ppos, pbcl);
+    else if ((ok= find_feas(puz, sol, k, i, ppos, pbcl)) < 0)
+    {
+	ok= run_feasible(puz, sol, k, i, ppos, pbcl);
+	if (ok && ppos != NULL)
+	    add_feas(puz, k, i, ok, *ppos, *pbcl);
+	else
+	    add_feas(puz, k, i, ok, NULL, NULL);
+    }
+
+    if (!ok) feas_fails++;
+    return ok;
+}
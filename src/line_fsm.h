@@ -0,0 +1,1133 @@
+/* Copyright 2007 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* LINE SOLVER TEMPLATE - The finite state machines that find the left-most
+ * and right-most solutions of a line.  This file is included into line_lro.c
+ * several times, each time with different settings of these macros, to
+ * compile versions of the solvers specialized for different kinds of clues:
+ *
+ *   FSM_LEFT, FSM_RIGHT - names to give the left and right solvers.
+ *   FSM_MULTI - true if the puzzle may have more than two colors.  Either
+ *               a constant, or 'multicolor' to test it at run time.
+ *   FSM_BLOTS - true if the clue may have blotted blocks.
+ *   FSM_DEBUG - true to include the debugging output.
+ *
+ * Where these are constant, the compiler drops the tests that depend on them
+ * from the inner loops.  They are all undefined again at the end.
+ */
+
+#define FD (FSM_DEBUG && D)
+#define FDU (FSM_DEBUG && DU)
+#define BLOTTED(b) (FSM_BLOTS && clue->length[b] == 0)
+
+/* Find leftmost solution for line i of clueset k
+ *
+ * On success, returns 0 and ppos and pbcl point to the solution. On
+ * failure returns 1.  ppos points to array of block position, pbcl points
+ * to array which gives lengths of any blotted clues. These arrays should
+ * not be freed by the calling program.
+ *
+ * This routine is structured as a finite state machine.  The state variable
+ * 'state' selects between various states we might be in.  Each state has a
+ * comment defining the precondition for that state.  This is basically a
+ * trick to make old-fashioned spaghetti code look like it makes sense.
+ */
+
+static int FSM_LEFT(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
+	line_t **ppos, line_t **pbcl)
+{
+    line_t b,j;
+    color_t currcolor, nextcolor;
+    int backtracking, state;
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t *pos, *cov, *bcl;
+
+    /* The solution is constructed and returned in the pos and bcl arrays.
+     * The pos array contains current position of each block, or more
+     * specifically the first cell of each block.  It's terminated by a -1.
+     * The bcl array is used only if we have blotted clues whose block
+     * length is variable. It gives the length of each blotted clue.
+     */
+    pos= (savepos) ? clue->lpos : lpos;
+    pos[clue->n]= -1;
+    bcl= savepos ? (clue->lbcl != NULL ? clue->lbcl : clue->length) : lbcl;
+    *ppos= pos;
+    *pbcl= bcl;
+
+    /* The cov array contains the index of the left-most cell covered by the
+     * block which CANNOT be white.  It is -1 if there is no such cell.
+     */
+    cov= savepos ? clue->lcov : gcov;
+
+    /* If we have a saved solution to start with, initialize off that.
+     * Otherwise, just start from scratch.
+     */
+    
+    if (!savepos || clue->lbadb == -1)
+    {
+	/* no usable saved solution.  Start fresh. */
+	b= 0;
+	state= NEWBLOCK;
+	if (FD)
+	    printf("L: NO OLD -- FRESH START\n");
+    }
+    else if (clue->lbadb == MAXLINE)
+    {
+    	/* Can reuse old solution completely. Note that we don't update the
+	 * time stamp in this case.
+	 */
+	if (FD)
+	{
+	    printf("L: OLD STILL VALID -- REUSING: ");
+	    dump_pos(stdout, pos, clue->length);
+	}
+	return SUCCESS;
+    }
+    else if (clue->lbadb % 2 == 0)
+    {
+	/* A cell in a gap was set to a non-background color.  Point b to
+	 * the preceding block, and start backtracking.  */
+	b= clue->lbadb/2;
+	state= BACKTRACK;
+	if (FD)
+	{
+	    printf("L: OLD INVALID AT %d INT %d (GAP) "
+		"-- BACKTRACK FROM BLOCK %d\n   ", clue->lbadi,clue->lbadb,b);
+	    dump_pos(stdout, pos, clue->length);
+        }
+    }
+    else
+    {
+    	/* A cell in a block has been set to different color. */
+	b= clue->lbadb/2;
+	if (FD)
+	    printf("L: OLD INVALID AT %d INT %d (BLOCK) -- ",
+		clue->lbadi,clue->lbadb);
+
+	if ((cov[b] < 0 || cov[b] > clue->lbadi) &&
+		(!FSM_MULTI || may_be_bg(cell[clue->lbadi])))
+	{
+	    /* Block covers nothing or covered cells are right of changed cell,
+	     * and changed cell can be background color, so we just skip past
+	     * it */
+	    pos[b]= clue->lbadi + 1;
+	    if (cell[pos[b]] == NULL)
+	    {
+		clue->lbadb= -1;
+		return FAIL;
+	    }
+	    currcolor= clue->color[b];
+	    state= PLACEBLOCK;
+	    if (FD)
+		printf("PLACEBLOCK %d AT %d\n   ",b,pos[b]);
+	}
+	else
+	{
+	    /* Block covers something, so we can't skip it ahead */
+	    state= BACKTRACK;
+	    if (FD)
+		printf("BACKTRACK FROM BLOCK %d\n   ",b);
+	}
+	if (FD)
+	    dump_pos(stdout, pos, clue->length);
+    }
+
+    backtracking= 0;
+
+    /* Finite State Machine */
+
+    while (state != HALT)
+    {
+    	switch (state)
+	{
+	case NEWBLOCK:
+
+	    /* Precondition: Blocks 0 through b-1 have been legally placed
+	     *    or b = 0.  If b > 0, then j is the index of the first cell
+	     *    after block b-1.
+	     * Action:  Begin placing block b after the previous one.
+	     */
+
+	    if (b >= clue->n)
+	    {
+		/* No blocks left.  Check rest of line to make sure it can
+		 * be blank.
+		 */
+		if (b-- == 0) j= 0;
+	    	state= CHECKREST; goto next;
+	    }
+
+	    currcolor= clue->color[b];	/* Color of current block */
+	    if (FD)
+		printf("L: PLACING BLOCK %d COLOR %d LENGTH %d\n",
+		    b,currcolor,BLOTTED(b)?1:clue->length[b]);
+
+	    /* Earliest possible position of block b, after previous blocks,
+	     * leaving a space between the blocks if they are the same color.
+	     */
+
+	    pos[b]= (b == 0) ? 0 :
+			j + ((clue->color[b-1] == currcolor) ? 1 : 0);
+
+	    if (cell[pos[b]] == NULL)
+	    {
+		/* No room for another block - fail */
+		clue->lbadb= -1;
+		return FAIL;
+	    }
+
+	    if (FD)
+		printf("L: FIRST POS %d\n",pos[b]);
+
+	    state= PLACEBLOCK; goto next;
+
+	case PLACEBLOCK:
+
+	    /* Precondition: Blocks 0 through b-1 have been legally placed
+	     *    or b = 0.  pos[b] points points to a position less than or
+	     *    equal to the position of block b.  currcolor is the color
+	     *    of the current block b.
+	     * Action:  Advance pos[b] until it points to a position where
+	     *    the next length[b] cells can all accomodate the block's
+	     *    color.  Also compute cov[b], the index of the leftmost
+	     *    cell covered by the block that cannot be background.
+	     */
+
+	    /* First find a place for the first cell of the block, skipping
+	     * over white cells until we find one.
+	     */
+
+	    while (!may_be(cell[pos[b]], currcolor))
+	    {
+		if (FD)
+		    printf("L: POS %d BLOCKED\n",pos[b]);
+
+		if (FSM_MULTI && !may_be_bg(cell[pos[b]]))
+		{
+		    /* We hit a cell that must be some color other
+		     * than the color of the current block.  Only hope is to
+		     * find a previously placed block that can be advanced to
+		     * cover it, so we backtrack.
+		     */
+		    if (FD)
+			printf("L: BACKTRACKING ON WRONG COLOR\n",pos[b]);
+		    j= pos[b];
+		    while (b > 1 && !may_be(cell[j], clue->color[b-1]))
+			b--;
+		    state= BACKTRACK; goto next;
+		}
+
+		if (FD)
+		    printf("L: SHIFT BLOCK TO %d\n",pos[b]+1);
+
+		if (cell[++pos[b]] == NULL)
+		{
+		    if (FD)
+			printf("L: END OF THE LINE\n");
+		    clue->lbadb= -1;
+		    return FAIL;	/* Hit end of line */
+		}
+	    }
+
+	    /* First cell has found a home, can we place the rest of the block?
+	     * While we are at at, compute cov[b].
+	     */
+	    if (FD)
+		printf("L: FIRST CELL OF %d PLACED AT %d\n",b,pos[b]);
+	    j= pos[b];
+	    cov[b]= (may_be_bg(cell[j]) ? -1 : j);
+
+	    bcl[b]= BLOTTED(b) ? 1 : clue->length[b];
+
+	    for (j++; j - pos[b] < bcl[b]; j++)
+	    {
+		if (FD)
+		    printf("L: CHECKING CELL AT %d\n",j);
+		if (cell[j] == NULL)
+		{
+		    if (FD)
+			printf("L: END OF THE LINE\n");
+		    clue->lbadb= -1;
+		    return FAIL;	/* Block runs off end of line */
+		}
+
+		if (!may_be(cell[j], currcolor))
+		{
+		    if (FD)
+			printf("L: FAILED AT %d\n",j);
+		    if (cov[b] == -1)
+		    {
+			/* block doesn't fit here, but it wasn't
+			 * covering anything, so just keep shifting it
+			 */
+			if (FD)
+			    printf("L: SKIP AHEAD\n");
+			pos[b]= j;
+			state= PLACEBLOCK; goto next;
+		    }
+		    else
+		    {
+			/* Block b cannot be placed.  Need to try advancing
+			 * block b-1.
+			 */
+			if (FD)
+			    printf("L: BACKTRACK\n");
+			state= BACKTRACK; goto next;
+		    }
+		}
+
+		/* Update cov[b] */
+		if (cov[b] == -1 && !may_be_bg(cell[j]))
+		    cov[b]= j;
+
+		if (FD)
+		    printf("L: OK AT %d (cov=%d)\n",j, cov[b]);
+	    }
+
+	    state= FINALSPACE; goto next;
+
+	case FINALSPACE:
+
+	    /* Precondition: Blocks 0 through b-1 have been legally placed
+	     *    or b = 0.  pos[b] points points to a position so that all
+	     *    cells of the block can accomodate the block's color.  j
+	     *    is the index of the first cell after the block.  currcolor
+	     *    is the color of the current block b.
+	     * Action:  Check if the first cell after the block is a legal
+	     *    color.  If it is the same color as the block, try advancing
+	     *    the block to cover that too.  If backtracking is true,
+	     *    also ensure the block covers something, and advance it until
+	     *	  it does.
+	     */
+
+	    if (FD)
+		printf("L: CHECKING FINAL SPACE\n");
+
+	    if (cell[j] != NULL)
+	    {
+		/* OK, we've found a place the block fits, now we check that
+		 * first cell AFTER the block is able to be some color
+		 * different than the block's color.
+		 *
+		 * nextcolor is a color the next cell can be other than
+		 * BGCOLOR. In multicolor puzzles it is the color of the next
+		 * clue (if it is a different color). If there is no such
+		 * color it is just set to BGCOLOR.
+		 */
+		nextcolor= (FSM_MULTI &&
+			(b < clue->n - 1) &&
+			(currcolor != clue->color[b+1])) ?
+			    clue->color[b+1] : BGCOLOR;
+
+		if (FD)
+		    printf("L:  NEXTCOLOR=%d\n",nextcolor);
+
+		while (cell[j] != NULL && !may_be_bg(cell[j]) &&
+			(nextcolor == BGCOLOR || !may_be(cell[j],nextcolor)))
+		{
+		    /* Next cell is wrong color - our strategy is different
+		     * for regular blocks and blotted blocks.
+		     */
+		    if (FD)
+			printf("L: NO FINAL SPACE\n");
+		    if (BLOTTED(b))
+		    {
+			/* For blotted clue blocks, we try stretching
+			 * the block to cover the cell.
+			 */
+			if (FSM_MULTI && !may_be(cell[j],currcolor))
+			{
+			    /* can't stretch the block.  BACKTRACK */
+			    state= BACKTRACK; goto next;
+			}
+			/* All's OK - go ahead and stretch the block */
+			bcl[b]++;
+
+			if (FD) printf("L: STRETCHING BLOCK TO %d",bcl[b]);
+		    }
+		    else
+		    {
+			/* For normal blocks, we try advancing the block one
+			 * cell. But we need to make sure that we don't
+			 * uncover any cells, and we need to make sure that
+			 * the cell at the end is one we can cover. Note that
+			 * we never advance blotted-clue blocks, because we
+			 * want them at their leftmost possible starting
+			 * position, and so stretching them is always a
+			 * better option.
+			 */
+			if (cov[b] == pos[b] ||
+			    (FSM_MULTI && !may_be(cell[j],currcolor)) )
+			{
+			    /* can't advance.  BACKTRACK */
+			    state= BACKTRACK; goto next;
+			}
+			/* All's OK - go ahead and advance the block */
+			pos[b]++;
+
+			if (FD) printf("L: ADVANCING BLOCK TO %d",pos[b]);
+		    }
+
+		    /* Succeeded in covering the cell either by stretching or
+		     * advancing the current block. Update coverage record.
+		     */
+		    if (cov[b] == -1 && !may_be_bg(cell[j]))
+			cov[b]= j;
+		    if (FD) printf(" (cov=%d)\n",cov[b]);
+		    j++;
+		}
+	    }
+
+	    /* At this point, we have successfully placed the block */
+
+	    /* If we are advancing a block after backtracking, it needs to
+	     * cover something.
+	     */
+	    if (backtracking && cov[b] == -1)
+	    {
+		if (FD)
+		    printf("L: BACKTRACK BLOCK COVERS NOTHING\n",cov[b]);
+		backtracking= 0;
+		state= ADVANCEBLOCK; goto next;
+	    }
+
+	    if (cell[j] == NULL && b < clue->n - 1)
+	    {
+		/* Ran out of space, but still have blocks left */
+		clue->lbadb= -1;
+		return FAIL;
+	    }
+
+	    /* Successfully placed block b - Go on to next block */
+	    b++;
+	    backtracking= 0;
+	    state= NEWBLOCK; goto next;
+
+	case CHECKREST:
+
+	    /* Precondition: All blocks have been legally placed.  j points
+	     *   to first empty space after last block.  b is the index of
+	     *   the last block, or -1 if there are no blocks.
+	     * Action:  Check that there are no cells after the last block
+	     *   which cannot be left background color.
+	     */
+
+	    if (cell[j] != NULL)
+	    {
+		if (FD)
+		    printf("L: PLACED LAST BLOCK - CHECK REST OF LINE\n");
+
+		for (; cell[j] != NULL; j++)
+		{
+		    if (FD)
+			printf("L: CELL %d ",j);
+		    if (!may_be_bg(cell[j]))
+		    {
+			/* Check if we can cover the uncovered square by sliding
+			 * the last block right far enough to cover it. (If it's
+			 * a blotted clue block, we will stretch it instead.)
+			 */
+			if (FD)
+			    printf("NEEDS COVERAGE\n");
+			j= pos[b] + bcl[b];
+			state= ADVANCEBLOCK; goto next;
+		    }
+		    else if (FD)
+			printf("OK\n");
+		}
+	    }
+
+	    state= HALT; goto next;
+
+	case BACKTRACK:
+
+	    /* Precondition: Blocks 0 through b-1 have been legally placed,
+	     *   but block b cannot be.
+	     * Action:  Try to advance (or stretch) block b-1 so that it
+	     *   covers something new that can't be background color,
+	     *   without uncovering anything that it previously covered.
+	     */
+
+	    if (--b < 0)
+	    {
+		if (FD)
+		    printf("L: NO BLOCKS LEFT TO BACKTRACK TO - FAIL\n");
+		clue->lbadb= -1;
+		return FAIL;
+	    }
+
+	    /* Point j to first cell after end of block */
+	    j= pos[b] + bcl[b];
+	    currcolor= clue->color[b];	/* Color of current block */
+
+	    if (FD)
+		printf("L: BACKTRACKING: ");
+
+	    state= ADVANCEBLOCK; goto next;
+
+	case ADVANCEBLOCK:
+
+	    /* Precondition: Blocks 0 through b have been legally placed.
+	     *   j points to the first cell after block b.  currcolor is the
+	     *   color of block b.
+	     * Action:  Try to advance block b so that it covers at least one
+	     *   new cell that can't be background color, without uncovering
+	     *   anything that block b previously covered. If the block is a
+	     *   blotted clue block, then we will prefer stretching it to
+	     *   advancing it.
+	     */
+
+	    if (FD)
+		printf("L: ADVANCE BLOCK %d (j=%d,cc=%d,pos=%d,cov=%d)\n",
+		    b,j,currcolor,pos[b],cov[b]);
+
+	    while(BLOTTED(b) || cov[b] < 0 || pos[b] < cov[b])
+	    {
+		if (!may_be(cell[j], currcolor))
+		{
+		    if (FD)
+			printf("L: ADVANCE HIT OBSTACLE ");
+		    if (cov[b] >= 0 || (FSM_MULTI && !may_be_bg(cell[j])))
+		    {
+			if (FD)
+			    printf("- BACKTRACKING\n");
+			state= BACKTRACK; goto next;
+		    }
+		    else
+		    {
+			/* Hit something we can't advance over, but we aren't
+			 * covering anything either, so jump past the obstacle.
+			 */
+			pos[b]= j+1;
+			if (FD)
+			    printf("- JUMPING pos=%d\n",pos[b]);
+			backtracking= 1;
+			state= PLACEBLOCK; goto next;
+		    }
+		}
+
+		/* Can advance.  Do it */
+		if (BLOTTED(b))
+		{
+		    bcl[b]++;
+		    if (FD)
+			printf("- STRETCHING BLOCK %d TO %d\n",b,bcl[b]);
+		}
+		else
+		{
+		    pos[b]++;
+		    if (FD)
+			printf("- ADVANCING BLOCK %d TO %d\n",b,pos[b]);
+		}
+
+		/* Check if we have covered anything.  If we have, we can
+		 * stop advancing
+		 */
+		if (!may_be_bg(cell[j++]))
+		{
+		    if (cov[b] == -1) cov[b]= j-1;
+		    if (FD)
+		    	printf("L: COVERED NEW TARGET AT %d - BLOCK AT %d"
+				" LENGTH %d\n", j-1, pos[b], bcl[b]);
+		    state= FINALSPACE; goto next;
+		}
+		if (cell[j] == NULL)
+		{
+		    if (FD)
+			printf("L: END OF LINE\n");
+		    clue->lbadb= -1;
+		    return FAIL;
+		}
+	    }
+
+	    /* If we drop out here, then we've advanced the block as far
+	     * as we can, but we haven't succeeded in covering anything new.
+	     * So backtrack further.
+	     */
+	    if (FD)
+		printf("L: CAN'T ADVANCE\n");
+	    state= BACKTRACK;
+	    goto next;
+	}
+	next:;
+    }
+
+    if (FD)
+	printf("L: DONE\n");
+
+    if (savepos)
+    {
+    	clue->lstamp= puz->nhist;
+	clue->lbadi= MAXLINE;
+	clue->lbadb= MAXLINE;
+	if (FDU)
+	    printf("L: SAVING AT %d\n",clue->lstamp);
+    }
+
+    return SUCCESS;
+}
+
+
+/* Find rightmost solution for line i of clueset k
+ *
+ * On success, returns 0 and ppos and pbcl point to the solution. On
+ * failure returns 1.  ppos points to array of ending indexes for blocks.
+ * pbcl points to array which gives lengths of any blotted clues. These
+ * arrays should not be freed by the calling program.
+ *
+ * This routine is structured as a finite state machine.  The state variable
+ * 'state' selects between various states we might be in.  Each state has a
+ * comment defining the precondition for that state.  This is basically a
+ * trick to make old-fashioned spaghetti code look like it makes sense.
+ */
+
+static int FSM_RIGHT(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
+	line_t **ppos, line_t **pbcl)
+{
+    line_t b,j;
+    color_t currcolor, nextcolor;
+    int backtracking, state;
+    Clue *clue= &puz->clue[k][i];
+    line_t ncell= clue->linelen;
+    Cell **cell= sol->line[k][i];
+    line_t maxblock= clue->n - 1;
+    line_t *pos, *cov, *bcl;
+
+    /* The solution is constructed and returned in the pos and bcl arrays.
+     * The pos array contains current position of each block, or more
+     * specifically the rightmost cell of each block.  It's terminated by a -1.
+     * The bcl array is used only if we have blotted clues whose block
+     * length is variable. It gives the length of each blotted clue.
+     */
+    pos= (savepos) ? clue->rpos : rpos;
+    pos[clue->n]= -1;
+    bcl= savepos ? (clue->rbcl != NULL ? clue->rbcl : clue->length) : rbcl;
+    *ppos= pos;
+    *pbcl= bcl;
+
+    /* The cov array contains the index of the right-most cell covered by the
+     * block which CANNOT be white.  It is -1 if there is no such cell.
+     */
+    cov= savepos ? clue->rcov : gcov;
+
+    if (!savepos || clue->rbadb == -1)
+    {
+    	/* no usable saved solution.  Start fresh. */
+	b= maxblock;
+	state= NEWBLOCK;
+	if (FD)
+	    printf("L: NO OLD -- FRESH START\n");
+    }
+    else if (clue->rbadb == MAXLINE)
+    {
+    	/* Can reuse old solution completely.  Note that we don't update the
+	 * time stamp in this case.  */
+	if (FD)
+	{
+	    printf("L: OLD STILL VALID -- REUSING: ");
+	    dump_pos(stdout, pos, clue->length);
+	}
+	return SUCCESS;
+    }
+    else if (clue->rbadb % 2 == 0)
+    {
+    	/* A cell in a gap was set to a non-background color.  Point b to
+	 * the preceding block, and start backtracking.  */
+	b= clue->rbadb/2 - 1;
+	state= BACKTRACK;
+	if (FD)
+	{
+	    printf("L: OLD INVALID AT %d INT %d (GAP) "
+		"-- BACKTRACK FROM BLOCK %d\n   ", clue->rbadi,clue->rbadb,b);
+	    dump_pos(stdout, pos, clue->length);
+	}
+    }
+    else
+    {
+    	/* A cell in a block has been set to different color. */
+	b= clue->rbadb/2;
+	if (FD)
+	    printf("L: OLD INVALID AT %d INT %d (BLOCK) -- ",
+		clue->rbadi,clue->rbadb);
+
+	if (cov[b] < clue->rbadi &&
+	    (!FSM_MULTI || may_be_bg(cell[clue->rbadi])))
+	{
+	    /* Block covers nothing, or covered cells are left of changed cell,
+	     * and changed cell can be background color, so we just skip past
+	     * it */
+	    pos[b]= clue->rbadi - 1;
+	    if (pos[b] < 0)
+	    {
+		clue->rbadb= -1;
+		return FAIL;
+	    }
+	    currcolor= clue->color[b];
+	    state= PLACEBLOCK;
+	    if (FD)
+		printf("PLACEBLOCK %d AT %d\n   ",b,pos[b]);
+	}
+	else
+	{
+	    /* Block covers something, so we can't skip it ahead */
+	    state= BACKTRACK;
+	    if (FD)
+		printf("BACKTRACK FROM BLOCK %d\n   ",b);
+	}
+	if (FD)
+	    dump_pos(stdout, pos, clue->length);
+    }
+
+    backtracking= 0;
+
+    /* Finite State Machine */
+
+    while (state != HALT)
+    {
+    	switch (state)
+	{
+	case NEWBLOCK:
+
+	    /* Precondition: Blocks b+1 through maxblock have been legally
+	     *    placed or b = maxblock.  If b < maxblock, then j is the
+	     *    index of the first cell left of block b+1.
+	     * Action:  Begin placing block b after the previous one.
+	     */
+
+	    if (b < 0)
+	    {
+		/* No blocks left.  Check rest of line to make sure it can
+		 * be blank.
+		 */
+		if (b++ == maxblock) j= ncell - 1;
+	    	state= CHECKREST; goto next;
+	    }
+
+	    currcolor= clue->color[b];	/* Color of current block */
+	    if (FD)
+		printf("L: PLACING BLOCK %d COLOR %d LENGTH %d\n",
+		    b,currcolor,BLOTTED(b)?1:clue->length[b]);
+
+	    /* Earliest possible position of block b, after previous blocks,
+	     * leaving a space between the blocks if they are the same color.
+	     */
+
+	    pos[b]= (b == maxblock) ? ncell - 1 :
+			j - ((clue->color[b+1] == currcolor) ? 1 : 0);
+
+	    if (pos[b] - (BLOTTED(b)?1:clue->length[b]) + 1 < 0)
+	    {
+		/* No room for another block - fail */
+		clue->rbadb= -1;
+		return FAIL;
+	    }
+
+	    if (FD)
+		printf("L: FIRST POS %d\n",pos[b]);
+
+	    state= PLACEBLOCK; goto next;
+
+	case PLACEBLOCK:
+
+	    /* Precondition: Blocks b+1 through maxblock have been legally
+	     *   placed or b = maxblock.  pos[b] points points to a position
+	     *   greater than or equal to the position of block b.  currcolor
+	     *   is the color of the current block b.
+	     * Action:  Advance pos[b] until it points to a position where
+	     *   the next length[b] cells can all accomodate the block's
+	     *   color.  Also compute cov[b], the index of the rightmost
+	     *   cell covered by the block that cannot be background.
+	     */
+
+	    /* First find a place for the first cell of the block, skipping
+	     * over white cells until we find one.
+	     */
+
+	    while (!may_be(cell[pos[b]], currcolor))
+	    {
+		if (FD)
+		    printf("L: POS %d BLOCKED\n",pos[b]);
+
+		if (FSM_MULTI && !may_be_bg(cell[pos[b]]))
+		{
+		    /* We hit a cell that must be some color other
+		     * than the color of the current block.  Only hope is to
+		     * find a previously placed block that can be advanced to
+		     * cover it, so we backtrack.
+		     */
+		    if (FD)
+			printf("L: BACKTRACKING ON WRONG COLOR\n",pos[b]);
+		    j= pos[b];
+		    while (b < maxblock-1 && !may_be(cell[j], clue->color[b+1]))
+			b++;
+		    state= BACKTRACK; goto next;
+		}
+
+		if (FD)
+		    printf("L: SHIFT BLOCK TO %d\n",pos[b]-1);
+
+		if (--pos[b] < 0)
+		{
+		    if (FD)
+			printf("L: END OF THE LINE\n");
+		    clue->rbadb= -1;
+		    return FAIL;	/* Hit end of line */
+		}
+	    }
+
+	    /* First cell has found a home, can we place the rest of the block?
+	     * While we are at at, compute cov[b].
+	     */
+	    if (FD)
+		printf("L: FIRST CELL OF %d PLACED AT %d\n",b,pos[b]);
+	    j= pos[b];
+	    cov[b]= (may_be_bg(cell[j]) ? -1 : j);
+
+	    bcl[b]= BLOTTED(b) ? 1 : clue->length[b];
+
+	    for (j--; pos[b] - j < bcl[b]; j--)
+	    {
+		if (FD)
+		    printf("L: CHECKING CELL AT %d\n",j);
+		if (j < 0)
+		{
+		    if (FD)
+			printf("L: END OF THE LINE\n");
+		    clue->rbadb= -1;
+		    return FAIL;	/* Block runs off end of line */
+		}
+
+		if (!may_be(cell[j], currcolor))
+		{
+		    if (FD)
+			printf("L: FAILED AT %d\n",j);
+		    if (cov[b] == -1)
+		    {
+			/* block doesn't fit here, but it wasn't
+			 * covering anything, so just keep shifting it
+			 */
+			if (FD)
+			    printf("L: SKIP AHEAD\n");
+			pos[b]= j;
+			state= PLACEBLOCK; goto next;
+		    }
+		    else
+		    {
+			/* Block b cannot be placed.  Need to try advancing
+			 * block b+1.
+			 */
+			if (FD)
+			    printf("L: BACKTRACK\n");
+			state= BACKTRACK; goto next;
+		    }
+		}
+
+		/* Update cov[b] */
+		if (cov[b] == -1 && !may_be_bg(cell[j]))
+		    cov[b]= j;
+
+		if (FD)
+		    printf("L: OK AT %d (cov=%d)\n",j, cov[b]);
+	    }
+
+	    state= FINALSPACE; goto next;
+
+	case FINALSPACE:
+
+	    /* Precondition: Blocks maxblock through b+1 have been legally
+	     *    placed or b = maxblock.  pos[b] points points to a position
+	     *    so that all cells of the block can accomodate the block's
+	     *    color.  j is the index of the first cell after the block.
+	     *    currcolor is the color of the current block b.
+	     * Action:  Check if the first cell after the block is a legal
+	     *    color.  If it is the same color as the block, try advancing
+	     *    the block to cover that too.  If backtracking is true,
+	     *    also ensure the block covers something, and advance it until
+	     *	  it does.
+	     */
+
+	    if (FD)
+		printf("L: CHECKING FINAL SPACE\n");
+
+	    if (j >= 0)
+	    {
+		/* OK, we've found a place the block fits, now we check that
+		 * first cell AFTER the block is able to be some color different
+		 * than the block's color.
+		 *
+		 * nextcolor is a color the next cell can be other than
+		 * BGCOLOR. In multicolor puzzles it is the color of the next
+		 * clue (if it is a different color). If there is no such
+		 * color it is just set to BGCOLOR.
+		 */
+		nextcolor= (FSM_MULTI &&
+			(b > 0) &&
+			(currcolor != clue->color[b-1])) ?
+			    clue->color[b-1] : BGCOLOR;
+
+		if (FD)
+		    printf("L:  NEXTCOLOR=%d\n",nextcolor);
+
+		while (j >= 0 && !may_be_bg(cell[j]) &&
+			(nextcolor == BGCOLOR || !may_be(cell[j],nextcolor)))
+		{
+		    /* Next cell is wrong color - our strategy is different
+		     * for regular blocks and blotted blocks. */
+		    if (FD)
+			printf("L: NO FINAL SPACE\n");
+		    if (BLOTTED(b))
+		    {
+			/* For blotted clue blocks, we try stretching
+			 * the block to cover the cell. */
+			if (FSM_MULTI && !may_be(cell[j],currcolor))
+			{
+			    /* can't stretch the block.  BACKTRACK */
+			    state= BACKTRACK; goto next;
+			}
+			/* All's OK - go ahead and stretch the block */
+			bcl[b]++;
+
+			if (FD) printf("L: STRETCHING BLOCK TO %d",bcl[b]);
+		    }
+		    else
+		    {
+			/* For normal blocks, we try advancing the block one
+			 * cell.  But we need to make sure that we don't
+			 * uncover any cells, and we need to make sure that
+			 * the cell at the end is one we can cover. Note that
+			 * we never advance blotted-clue blocks, because
+			 * we want them at their rightmost possible starting
+			 * position, so stretching them is always the
+			 * prefered option.
+			 */
+			if (cov[b] == pos[b] ||
+			    (FSM_MULTI && !may_be(cell[j],currcolor)) )
+			{
+			    /* can't advance.  BACKTRACK */
+			    state= BACKTRACK; goto next;
+			}
+			/* All's OK - go ahead and advance the block */
+			pos[b]--;
+
+			if (FD) printf("L: ADVANCING BLOCK TO %d",pos[b]);
+		    }
+
+		    /* Succeeded in covering the cell either by stretching or
+		     * advancing the current block. Update coverage record. */
+		    if (cov[b] == -1 && !may_be_bg(cell[j]))
+			cov[b]= j;
+		    if (FD) printf(" (cov=%d)\n",cov[b]);
+		    j--;
+		}
+	    }
+
+	    /* At this point, we have successfully placed the block */
+
+	    /* If we are advancing a block after backtracking, it needs to
+	     * cover something.
+	     */
+	    if (backtracking && cov[b] == -1)
+	    {
+		if (FD)
+		    printf("L: BACKTRACK BLOCK COVERS NOTHING\n",cov[b]);
+		backtracking= 0;
+		state= ADVANCEBLOCK; goto next;
+	    }
+
+	    if (j < 0 && b > 0)
+	    {
+		/* Ran out of space, but still have blocks left */
+		clue->rbadb= -1;
+		return FAIL;
+	    }
+
+	    /* Successfully placed block b - Go on to next block */
+	    b--;
+	    backtracking= 0;
+	    state= NEWBLOCK; goto next;
+
+	case CHECKREST:
+
+	    /* Precondition: All blocks have been legally placed.  j points
+	     *   to first empty space before last block.  b is the index of
+	     *   the last block, or -1 if there are no blocks.
+	     * Action:  Check that there are no cells before the last block
+	     *   which cannot be left background color.
+	     */
+
+	    if (j >= 0)
+	    {
+		if (FD)
+		    printf("L: PLACED LAST BLOCK - CHECK REST OF LINE\n");
+
+		for (; j >= 0; j--)
+		{
+		    if (FD)
+			printf("L: CELL %d ",j);
+		    if (!may_be_bg(cell[j]))
+		    {
+			/* Check if we can cover the uncovered square by sliding
+			 * the last block right far enough to cover it. (If it's
+			 * a blotted lue, we will stretch it instead.)
+			 */
+			if (FD)
+			    printf("NEEDS COVERAGE (cov=%d j=%d)\n",cov[b],j);
+			j= pos[b] - bcl[b];
+			state= ADVANCEBLOCK; goto next;
+		    }
+		    else if (FD)
+			printf("OK\n");
+		}
+	    }
+
+	    state= HALT; goto next;
+
+	case BACKTRACK:
+
+	    /* Precondition: Blocks maxblock through b+1 have been legally
+	     *   placed, but block b cannot be.
+	     * Action:  Try to advance (or stretch) block b+1 so that it
+	     *   covers something new that can't be background color,
+	     *   without uncovering anything that it previously covered.
+	     */
+
+	    if (++b > maxblock)
+	    {
+		if (FD)
+		    printf("L: NO BLOCKS LEFT TO BACKTRACK TO - FAIL\n");
+		clue->rbadb= -1;
+		return FAIL;
+	    }
+
+	    /* Point j to first cell before start of block */
+	    j= pos[b] - bcl[b];
+	    currcolor= clue->color[b];	/* Color of current block */
+
+	    if (FD)
+		printf("L: BACKTRACKING: ");
+
+	    state= ADVANCEBLOCK; goto next;
+
+	case ADVANCEBLOCK:
+
+	    /* Precondition: Blocks maxblock through b+1 have been legally
+	     *   placed.  j points to the first cell before block b.
+	     *   currcolor is the color of block b.
+	     * Action:  Try to advance block b so that it covers at least one
+	     *   new cell that can't be background color, without uncovering
+	     *   anything that block b previously covered. If the block is a
+	     *   blotted clue block, then we will prefer stretching it to
+	     *   advancing it.
+	     */
+
+	    if (FD)
+		printf("L: ADVANCE BLOCK %d (j=%d,cc=%d,pos=%d,cov=%d)\n",
+		    b,j,currcolor,pos[b],cov[b]);
+
+	    while(BLOTTED(b) || cov[b] < 0 || pos[b] > cov[b])
+	    {
+		if (!may_be(cell[j], currcolor))
+		{
+		    if (FD)
+			printf("L: ADVANCE HIT OBSTACLE ");
+		    if (cov[b] >= 0 || (FSM_MULTI && !may_be_bg(cell[j])))
+		    {
+			if (FD)
+			    printf("- BACKTRACKING\n");
+			state= BACKTRACK; goto next;
+		    }
+		    else
+		    {
+			/* Hit something we can't advance over, but we aren't
+			 * covering anything either, so jump past the obstacle.
+			 */
+			pos[b]= j-1;
+			if (FD)
+			    printf("- JUMPING pos=%d\n",pos[b]);
+			backtracking= 1;
+			state= PLACEBLOCK; goto next;
+		    }
+		}
+
+		/* Can advance (or stretch).  Do it */
+		if (BLOTTED(b))
+		{
+		    bcl[b]++;
+		    if (FD)
+			printf("- STRETCHING BLOCK %d TO %d\n",b,bcl[b]);
+		}
+		else
+		{
+		    pos[b]--;
+		    if (FD)
+			printf("- ADVANCING BLOCK %d TO %d\n",b,pos[b]);
+		}
+
+		/* Check if we have covered anything.  If we have, we can
+		 * stop advancing
+		 */
+		if (!may_be_bg(cell[j--]))
+		{
+		    if (cov[b] == -1) cov[b]= j+1;
+		    if (FD)
+		    	printf("L: COVERED NEW TARGET AT %d - BLOCK AT %d"
+				" LENGTH %d\n", j+1, pos[b], bcl[b]);
+		    state= FINALSPACE; goto next;
+		}
+		if (j < 0)
+		{
+		    if (FD)
+			printf("L: END OF LINE\n");
+		    clue->rbadb= -1;
+		    return FAIL;
+		}
+	    }
+
+	    /* If we drop out here, then we've advanced the block as far
+	     * as we can, but we haven't succeeded in covering anything new.
+	     * So backtrack further.
+	     */
+	    if (FD)
+		printf("L: CAN'T ADVANCE\n");
+	    state= BACKTRACK;
+	    goto next;
+	}
+	next:;
+    }
+
+    if (FD)
+	printf("L: DONE\n");
+
+    if (savepos)
+    {
+    	clue->rstamp= puz->nhist;
+	clue->rbadi= -1;
+	clue->rbadb= MAXLINE;
+	if (FDU)
+	    printf("L: SAVING AT %d\n",clue->rstamp);
+
+    }
+    return SUCCESS;
+}
+
+#undef FD
+#undef FDU
+#undef BLOTTED
+#undef FSM_LEFT
+#undef FSM_RIGHT
+#undef FSM_MULTI
+#undef FSM_BLOTS
+#undef FSM_DEBUG
@@ -28,6 +28,11 @@
 #define D (WL || VL)
 #define DU (WL || (VL && VU))
 
+/* Line solver variants, for the fsm field of a clue */
+#define FSM_TWOCOLOR	0	/* Two color puzzle, no blotted clues */
+#define FSM_MULTICOLOR	1	/* Multicolor puzzle, no blotted clues */
+#define FSM_BLOTTED	2	/* Clue has blotted clues */
+
 /* Allocate some arrays to be used in left_solve(), right_solve(), and
  * lro_solve() to a size appropriate for puzzle puz.  Also creates the
  * saved position arrays that go in the puz->clue data structure.
@@ -39,10 +44,29 @@ static bit_type *col;
 static int multicolor;
 bit_type *oldval;
 
+/* Line masks for the bit-parallel two color solver.  These are described
+ * further below, with the solver.
+ */
+static bit_type *bw_white, *bw_black, *bw_must, *bw_cand, *bw_tmp;
+static byte *bw_have;
+static int bw_nword, bw_maxword;
+
+/* The change list.  Line solvers report their results as a list of the cells
+ * whose possible colors they narrowed.  chgidx[n] is the index in the line of
+ * the n-th changed cell, and chgbits(n) is its new bitstring.  lro_solve()
+ * builds this directly.  For the other solvers, which return a full column
+ * of bitstrings, col_changes() builds it from their result.
+ */
+static line_t nchg, *chgidx;
+static bit_type *chgbit;
+#define chgbits(n) (chgbit+(fbit_size*(n)))
+#define add_change(j,c) \
+    { chgidx[nchg]= (j); fbit_setonly(chgbits(nchg),(c)); nchg++; }
+
 void init_line(Puzzle *puz)
 {
     line_t maxcluelen= 0, maxdimension= 0;
-    line_t i,j;
+    line_t i;
     dir_t k;
 
     /* Set a flag if the puzzle is multicolored.  If not, we can skip some
@@ -50,6 +74,9 @@ void init_line(Puzzle *puz)
      */
     multicolor= (puz->ncolor > 2);
 
+    /* Nothing left over from any previous puzzle */
+    init_trail();
+
     /* Find maximum number of numbers in any clue in any direction and
      * maximum length of a line
      */
@@ -61,34 +88,17 @@ void init_line(Puzzle *puz)
 	{
 	    if (puz->clue[k][i].n > maxcluelen) maxcluelen= puz->clue[k][i].n;
 
-	    /* Allocate a left and right saved position array for each clue.
-	     * Note that these are -1 terminated, so they have 1 added to
-	     * their size.  */
-	    puz->clue[k][i].lpos=
-		(line_t *)malloc((puz->clue[k][i].n + 1) * sizeof(line_t));
+	    /* The left and right saved position arrays, and the coverage and
+	     * blocklength arrays that go with them, were carved out of the
+	     * clue block by pack_clues().  The position arrays are -1
+	     * terminated.  Clues with blots are the only ones with lbcl and
+	     * rbcl arrays. */
 	    puz->clue[k][i].lpos[puz->clue[k][i].n]= -1;
-	    puz->clue[k][i].rpos=
-		(line_t *)malloc((puz->clue[k][i].n + 1) * sizeof(line_t));
 	    puz->clue[k][i].rpos[puz->clue[k][i].n]= -1;
 
-	    /* If there are any blots in the clue, allocate saved blocklength
-	     * arrays for the left and right solver */
-	    puz->clue[k][i].lbcl= puz->clue[k][i].rbcl= NULL;
-	    for (j= 0; j < puz->clue[k][i].n; j++)
-		if (puz->clue[k][i].length[j] == 0)
-		{
-		    puz->clue[k][i].lbcl=
-			(line_t *)malloc((puz->clue[k][i].n) * sizeof(line_t));
-		    puz->clue[k][i].rbcl=
-			(line_t *)malloc((puz->clue[k][i].n) * sizeof(line_t));
-		    break;
-		}
-
-	    /* Allocate a left and right coverage array for each clue */
-	    puz->clue[k][i].lcov=
-		(line_t *)malloc(puz->clue[k][i].n * sizeof(line_t));
-	    puz->clue[k][i].rcov=
-		(line_t *)malloc(puz->clue[k][i].n * sizeof(line_t));
+	    /* Choose the line solver variant for the clue */
+	    puz->clue[k][i].fsm= (puz->clue[k][i].lbcl != NULL) ? FSM_BLOTTED :
+		(multicolor ? FSM_MULTICOLOR : FSM_TWOCOLOR);
 
 	    /* Setting lbadb and rbadb to -1 means no saved solutions yet.
 	     * Setting them to MAXINT means a valid solution.
@@ -99,14 +109,39 @@ void init_line(Puzzle *puz)
 	    puz->clue[k][i].rbadi= -1;
 	    puz->clue[k][i].lstamp= MAXLINE;
 	    puz->clue[k][i].rstamp= MAXLINE;
+	    puz->clue[k][i].trail= -1;
+	    puz->clue[k][i].lstale= puz->clue[k][i].rstale= 0;
 	}
     }
 
+    /* Free the work arrays of any previous puzzle.  Only some puzzles get
+     * the color count and bit-parallel arrays, so those are cleared too.
+     */
+    free(lpos);
+    free(rpos);
+    free(lbcl);
+    free(rbcl);
+    free(gcov);
+    free(oldval);
+    free(col);
+    free(chgidx);
+    free(chgbit);
+    free(nbcolor);
+    free(bw_white);
+    free(bw_black);
+    free(bw_must);
+    free(bw_tmp);
+    free(bw_cand);
+    free(bw_have);
+    nbcolor= NULL;
+    bw_white= bw_black= bw_must= bw_tmp= bw_cand= NULL;
+    bw_have= NULL;
+
     /* Allocate storage spaces for left_solve and right_solve arrays.  We
      * use these instead of the ones in the Clue structure if we don't want
      * to save the results of the solution.
      */
-    lpos= (line_t *)malloc((maxcluelen + 1) * sizeof(line_t));
+    lpos=(line_t *)malloc((maxcluelen + 1) * sizeof(line_t));
     rpos= (line_t *)malloc((maxcluelen + 1) * sizeof(line_t));
     lbcl= (line_t *)malloc(maxcluelen * sizeof(int));
     rbcl= (line_t *)malloc(maxcluelen * sizeof(int));
@@ -116,8 +151,25 @@ void init_line(Puzzle *puz)
     oldval= (bit_type*)malloc(fbit_size * sizeof(bit_type));
 
     col= (bit_type *)malloc(maxdimension * fbit_size * sizeof(bit_type));
+    chgidx= (line_t *)malloc(maxdimension * sizeof(line_t));
+    chgbit= (bit_type *)malloc(maxdimension * fbit_size * sizeof(bit_type));
     if (puz->ncolor > 2)
 	nbcolor= (line_t *)malloc(puz->ncolor * sizeof(line_t));
+    else
+    {
+	/* Masks for the bit-parallel solver.  These have room for one bit
+	 * past the end of the longest line.  There is a candidate mask for
+	 * each block of the longest clue.
+	 */
+	bw_maxword= bit_size((maxdimension + 1));
+	bw_white= (bit_type *)malloc(bw_maxword * sizeof(bit_type));
+	bw_black= (bit_type *)malloc(bw_maxword * sizeof(bit_type));
+	bw_must= (bit_type *)malloc(bw_maxword * sizeof(bit_type));
+	bw_tmp= (bit_type *)malloc(bw_maxword * sizeof(bit_type));
+	bw_cand= (bit_type *)
+	    malloc((maxcluelen + 1) * bw_maxword * sizeof(bit_type));
+	bw_have= (byte *)malloc(maxcluelen + 1);
+    }
 }
 
 
@@ -262,143 +314,146 @@ int right_check(Clue *clue, line_t i, bit_type *bit)
 }
 
 
-/* Update the solution and coverage arrays after undoing a cell.  We are
- * given the clue, the solution line, the index of the cell in the line, the
- * new value of the cell.
+/* TRAIL - When we backtrack, we need to put the saved left and right
+ * solutions of each line back the way they were at the branch point we are
+ * backing up to.  So the first time after a branch point that anything
+ * changes the saved solutions of a clue, we push a copy of them onto the
+ * trail, and when we undo the branch point we pop the copies back off and
+ * restore them.  That way lines keep their saved solutions across undos,
+ * and the left and right solvers can pick up where they left off instead of
+ * starting from scratch.  This matters most when probing, where every probe
+ * is a guess that is undone again.
+ *
+ * Each branch point pushes a marker onto the trail.  trail_top is the index
+ * of the marker for the current branch point, or -1 if there is none, and
+ * clue->trail is the value trail_top had when the clue was last pushed.  A
+ * clue needs to be pushed again only if those differ.
  */
 
-void left_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new)
-{
-    line_t b, e;
+typedef struct {
+    Clue *clue;		/* Clue saved, or NULL for a branch marker */
+    int prev;		/* Old clue->trail, or for markers, old trail_top */
+    line_t lbadb, rbadb, lbadi, rbadi;
+    int lstamp, rstamp;
+    int data;		/* Index of saved arrays in trail_data */
+} Trail;
 
-    /* If we are backtracking past the point where this solution was first
-     * found, then discard it entirely.  */
-    if (puz->nhist <= clue->lstamp)
-    {
-    	clue->lbadb= -1;
-	if (DU)
-	    printf(" -- LEFT INVALIDATED");
-	return;
-    }
+static Trail *trail= NULL;
+static int ntrail= 0, strail= 0;
+static line_t *trail_data= NULL;
+static int ndata= 0, sdata= 0;
+int trail_top= -1;
 
-    /* If there is no saved solution, don't check it */
-    if (clue->lbadb == -1) return;
 
-    /* It is possible that the line is marked bad at this point, if a failure
-     * in some other line caused us to start backtracking before this line
-     * could be rechecked.  But back at the last guess point it must have been
-     * OK, because there were no jobs on the list.  So since we are going to
-     * backtrack until the last guess point, it's safe to mark the line OK.
-     */
-    clue->lbadb= MAXLINE;
-    clue->lbadi= MAXLINE;
-
-    /* If this cell is the leftmost can't-be-white cell in some block and
-     * we are undoing it so it can-be-white, then lcov for that block must
-     * change.  Note that this is the only case where lcov needs to be
-     * undated.  If the cell is in a gap it doesn't effect lcov.  If it is
-     * in block b and left of lcov[b], then it already can-be-white and
-     * undoing won't change that. If it is block b and right of lcov[b], then
-     * lcov[b] will remain the leftmost can't-be-white cell in the block
-     * whatever we do to this cell.
-     */
+/* INIT_TRAIL - Empty the trail, before starting on a new puzzle. */
 
-    /* Look for an interval with lcov[b] == our cell */
-    for (b= 0;  b < clue->n; b++)
-    	if (i == clue->lcov[b])
-	{
-	    /* We were the leftmost can't-be-white cell of block b */
+void init_trail(void)
+{
+    ntrail= 0;
+    ndata= 0;
+    trail_top= -1;
+}
 
-	    /* If we still can't be white, no change is needed */
-	    if (multicolor && !bit_bg(new)) return;
 
-	    /* Scan right from the current position through the block,
-	     * looking for another can't-be-white cell */
-	    e= clue->lpos[b] + clue->length[b];
-	    for (i++; i < e; i++)
-	    	if (!may_be_bg(line[i]))
-		{
-		    /* Found one */
-		    clue->lcov[b]= i;
-		    if (DU)
-			printf(" -- LCOV[%d] SET TO %d",b,i);
-		    return;
-		}
-	    /* Found none */
-	    clue->lcov[b]= -1;
-	    if (DU)
-		printf(" -- LCOV[%d] SET TO -1",b);
-	}
+/* TRAIL_BRANCH - Push a branch point marker onto the trail.  This should be
+ * called whenever a branch point is added to the history.
+ */
 
-    /* Cell is not the lcov of any block */
-    return;
+void trail_branch(Puzzle *puz)
+{
+    if (ntrail >= strail)
+    {
+	strail= strail ? 2*strail : 256;
+	trail= (Trail *)realloc(trail, strail * sizeof(Trail));
+    }
+    trail[ntrail].clue= NULL;
+    trail[ntrail].prev= trail_top;
+    trail_top= ntrail++;
 }
 
-void right_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new)
+
+/* TRAIL_SAVE - Push a copy of the saved solutions for a clue onto the trail.
+ * This is called through the trail_clue() macro, which only calls this if
+ * the clue hasn't already been saved since the last branch point.
+ */
+
+void trail_save(Clue *clue)
 {
-    line_t b, e;
+    Trail *t;
+    int n= clue->n;
+    int need= (clue->lbcl != NULL) ? 6*n : 4*n;
 
-    /* If we are backtracking past the point where this solution was first
-     * found, then discard it entirely.  */
-    if (puz->nhist <= clue->rstamp)
+    if (ntrail >= strail)
     {
-    	clue->rbadb= -1;
-	if (DU)
-	    printf(" -- RIGHT INVALIDATED");
-	return;
+	strail= strail ? 2*strail : 256;
+	trail= (Trail *)realloc(trail, strail * sizeof(Trail));
+    }
+    if (ndata + need > sdata)
+    {
+	sdata= (sdata ? 2*sdata : 1024) + need;
+	trail_data= (line_t *)realloc(trail_data, sdata * sizeof(line_t));
     }
 
-    /* If there is no saved solution, don't check it */
-    if (clue->rbadb == -1) return;
+    t= &trail[ntrail++];
+    t->clue= clue;
+    t->prev= clue->trail;
+    t->lbadb= clue->lbadb; t->rbadb= clue->rbadb;
+    t->lbadi= clue->lbadi; t->rbadi= clue->rbadi;
+    t->lstamp= clue->lstamp; t->rstamp= clue->rstamp;
+    t->data= ndata;
+
+    memcpy(trail_data + ndata, clue->lpos, n * sizeof(line_t));
+    memcpy(trail_data + ndata + n, clue->rpos, n * sizeof(line_t));
+    memcpy(trail_data + ndata + 2*n, clue->lcov, n * sizeof(line_t));
+    memcpy(trail_data + ndata + 3*n, clue->rcov, n * sizeof(line_t));
+    if (clue->lbcl != NULL)
+    {
+	memcpy(trail_data + ndata + 4*n, clue->lbcl, n * sizeof(line_t));
+	memcpy(trail_data + ndata + 5*n, clue->rbcl, n * sizeof(line_t));
+    }
+    ndata+= need;
 
-    /* It is possible that the line is marked bad at this point, if a failure
-     * in some other line caused us to start backtracking before this line
-     * could be rechecked.  But back at the last guess point it must have been
-     * OK, because there were no jobs on the list.  So since we are going to
-     * backtrack until the last guess point, it's safe to mark the line OK.
-     */
-    clue->rbadb= MAXLINE;
-    clue->rbadi= -1;
-
-    /* If this cell is the rightmost can't-be-white cell in some block and
-     * we are undoing it so it can-be-white, then rcov for that block must
-     * change.  Note that this is the only case where rcov needs to be
-     * undated.  If the cell is in a gap it doesn't effect rcov.  If it is
-     * in block b and right of rcov[b], then it already can-be-white and
-     * undoing won't change that. If it is block b and left of rcov[b], then
-     * rcov[b] will remain the rightmost can't-be-white cell in the block
-     * whatever we do to this cell.
-     */
+    clue->trail= trail_top;
+}
 
-    /* Look for an interval with rcov[b] == our cell */
-    for (b= 0;  b < clue->n; b++)
-    	if (i == clue->rcov[b])
-	{
-	    /* We were the rightmost can't-be-white cell of block b */
 
-	    /* If we still can't be white, no change is needed */
-	    if (multicolor && !bit_bg(new)) return;
+/* TRAIL_UNDO - Pop everything off the trail back to and including the last
+ * branch point marker, restoring the saved solutions of the clues as we go.
+ * This should be called when undo() reaches a branch point.
+ */
 
-	    /* Scan left from the current position through the block,
-	     * looking for another can't-be-white cell */
-	    e= clue->rpos[b];
-	    for (i--; i >= e; i--)
-	    	if (!may_be_bg(line[i]))
-		{
-		    /* Found one */
-		    clue->rcov[b]= i;
-		    if (DU)
-			printf(" -- RCOV[%d] SET TO %d",b,i);
-		    return;
-		}
-	    /* Found none */
-	    clue->rcov[b]= -1;
-	    if (DU)
-		printf(" -- RCOV[%d] SET TO -1",b);
+void trail_undo(Puzzle *puz)
+{
+    Trail *t;
+    Clue *clue;
+    line_t n;
+
+    while (ntrail > 0)
+    {
+	t= &trail[--ntrail];
+	if ((clue= t->clue) == NULL)
+	{
+	    trail_top= t->prev;
+	    return;
 	}
 
-    /* Cell is not the rcov of any block */
-    return;
+	n= clue->n;
+	ndata= t->data;
+	memcpy(clue->lpos, trail_data + ndata, n * sizeof(line_t));
+	memcpy(clue->rpos, trail_data + ndata + n, n * sizeof(line_t));
+	memcpy(clue->lcov, trail_data + ndata + 2*n, n * sizeof(line_t));
+	memcpy(clue->rcov, trail_data + ndata + 3*n, n * sizeof(line_t));
+	if (clue->lbcl != NULL)
+	{
+	    memcpy(clue->lbcl, trail_data + ndata + 4*n, n * sizeof(line_t));
+	    memcpy(clue->rbcl, trail_data + ndata + 5*n, n * sizeof(line_t));
+	}
+	clue->lbadb= t->lbadb; clue->rbadb= t->rbadb;
+	clue->lbadi= t->lbadi; clue->rbadi= t->rbadi;
+	clue->lstamp= t->lstamp; clue->rstamp= t->rstamp;
+	clue->trail= t->prev;
+    }
+    trail_top= -1;
 }
 
 
@@ -412,6 +467,47 @@ void right_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new)
 #define ADVANCEBLOCK	5
 #define HALT		6
 
+/* LINE SOLVER VARIANTS - The left and right solvers are compiled from
+ * line_fsm.h once for each kind of clue, and init_line() sets each clue's
+ * fsm field to say which to use.  A general version, with debugging output,
+ * is used when debugging is turned on.
+ */
+
+#define FSM_LEFT left_solve_2c
+#define FSM_RIGHT right_solve_2c
+#define FSM_MULTI 0
+#define FSM_BLOTS 0
+#define FSM_DEBUG 0
+#include "line_fsm.h"
+
+#define FSM_LEFT left_solve_mc
+#define FSM_RIGHT right_solve_mc
+#define FSM_MULTI 1
+#define FSM_BLOTS 0
+#define FSM_DEBUG 0
+#include "line_fsm.h"
+
+#define FSM_LEFT left_solve_bl
+#define FSM_RIGHT right_solve_bl
+#define FSM_MULTI multicolor
+#define FSM_BLOTS 1
+#define FSM_DEBUG 0
+#include "line_fsm.h"
+
+#define FSM_LEFT left_solve_dbg
+#define FSM_RIGHT right_solve_dbg
+#define FSM_MULTI multicolor
+#define FSM_BLOTS 1
+#define FSM_DEBUG 1
+#include "line_fsm.h"
+
+typedef int fsm_solver(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	int savepos, line_t **ppos, line_t **pbcl);
+
+static fsm_solver *left_fsm[]= {left_solve_2c, left_solve_mc, left_solve_bl};
+static fsm_solver *right_fsm[]= {right_solve_2c,right_solve_mc,right_solve_bl};
+
+
 /* Find leftmost solution for line i of clueset k
  *
  * On success, returns 0 and ppos and pbcl point to the solution. On
@@ -419,534 +515,361 @@ void right_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new)
  * to array which gives lengths of any blotted clues. These arrays should
  * not be freed by the calling program.
  *
- * This routine is structured as a finite state machine.  The state variable
- * 'state' selects between various states we might be in.  Each state has a
- * comment defining the precondition for that state.  This is basically a
- * trick to make old-fashioned spaghetti code look like it makes sense.
+ * This just calls the variant of the solver for the clue.
  */
 
 int left_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	line_t **ppos, line_t **pbcl)
 {
-    line_t b,j;
-    color_t currcolor, nextcolor;
-    int backtracking, state;
     Clue *clue= &puz->clue[k][i];
-    Cell **cell= sol->line[k][i];
-    line_t *pos, *cov, *bcl;
 
-    /* The solution is constructed and returned in the pos and bcl arrays.
-     * The pos array contains current position of each block, or more
-     * specifically the first cell of each block.  It's terminated by a -1.
-     * The bcl array is used only if we have blotted clues whose block
-     * length is variable. It gives the length of each blotted clue.
-     */
-    pos= (savepos) ? clue->lpos : lpos;
-    pos[clue->n]= -1;
-    bcl= savepos ? (clue->lbcl != NULL ? clue->lbcl : clue->length) : lbcl;
-    *ppos= pos;
-    *pbcl= bcl;
+    if (D)
+	return left_solve_dbg(puz, sol, k, i, savepos, ppos, pbcl);
+    return (*left_fsm[clue->fsm])(puz, sol, k, i, savepos, ppos, pbcl);
+}
 
-    /* The cov array contains the index of the left-most cell covered by the
-     * block which CANNOT be white.  It is -1 if there is no such cell.
-     */
-    cov= savepos ? clue->lcov : gcov;
 
-    /* If we have a saved solution to start with, initialize off that.
-     * Otherwise, just start from scratch.
-     */
-    
-    if (!savepos || clue->lbadb == -1)
-    {
-	/* no usable saved solution.  Start fresh. */
-	b= 0;
-	state= NEWBLOCK;
-	if (D)
-	    printf("L: NO OLD -- FRESH START\n");
-    }
-    else if (clue->lbadb == MAXLINE)
-    {
-    	/* Can reuse old solution completely. Note that we don't update the
-	 * time stamp in this case.
-	 */
-	if (D)
-	{
-	    printf("L: OLD STILL VALID -- REUSING: ");
-	    dump_pos(stdout, pos, clue->length);
-	}
-	return SUCCESS;
-    }
-    else if (clue->lbadb % 2 == 0)
+/* Find rightmost solution for line i of clueset k
+ *
+ * On success, returns 0 and ppos and pbcl point to the solution. On
+ * failure returns 1.  ppos points to array of ending indexes for blocks.
+ * pbcl points to array which gives lengths of any blotted clues. These
+ * arrays should not be freed by the calling program.
+ *
+ * This just calls the variant of the solver for the clue.
+ */
+
+int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
+	line_t **ppos, line_t **pbcl)
+{
+    Clue *clue= &puz->clue[k][i];
+
+    if (D)
+	return right_solve_dbg(puz, sol, k, i, savepos, ppos, pbcl);
+    return (*right_fsm[clue->fsm])(puz, sol, k, i, savepos, ppos, pbcl);
+}
+
+
+/* BIT-PARALLEL SOLVER - For two color puzzles with no blotted clues, we can
+ * find the left-most and right-most solutions by operating on whole words of
+ * the line at once, instead of stepping the finite state machine above
+ * through one cell at a time.
+ *
+ * The line is loaded into three masks:  bw_white and bw_black have a bit set
+ * for each cell that may be white or black, and bw_must has a bit set for
+ * each cell that cannot be white.  For each block b we build a candidate mask, with a bit set at each
+ * position where the block could start:  the cells it would cover may all be
+ * black and the cells just before and after it may be white (or are off the
+ * ends of the line).  Placing a block is then a matter of finding the next
+ * set bit in its candidate mask, and checking for uncovered black cells is
+ * a matter of finding the next set bit in bw_must.
+ *
+ * The results, including the saved positions and coverage arrays, are
+ * exactly the same as would be produced by left_solve() and right_solve().
+ */
+
+#ifdef __GNUC__
+#define bw_ctz(x) __builtin_ctzl(x)
+#define bw_clz(x) __builtin_clzl(x)
+#else
+static int bw_ctz(bit_type x)
+{
+    int n= 0;
+    while (!(x & 1)) { x>>= 1; n++; }
+    return n;
+}
+static int bw_clz(bit_type x)
+{
+    int n= 0;
+    while (!(x & (((bit_type)1) << (_bit_intsiz - 1)))) { x<<= 1; n++; }
+    return n;
+}
+#endif
+
+/* Shift the bw_nword word bit string src down by s bits, so that bit p+s of
+ * src becomes bit p of dst.  Bits shifted in from the top are zeros.
+ */
+
+static void bw_shift_down(bit_type *dst, bit_type *src, int s)
+{
+    int ws= s / _bit_intsiz, bs= s % _bit_intsiz;
+    int w;
+    bit_type x;
+
+    for (w= 0; w < bw_nword; w++)
     {
-	/* A cell in a gap was set to a non-background color.  Point b to
-	 * the preceding block, and start backtracking.  */
-	b= clue->lbadb/2;
-	state= BACKTRACK;
-	if (D)
-	{
-	    printf("L: OLD INVALID AT %d INT %d (GAP) "
-		"-- BACKTRACK FROM BLOCK %d\n   ", clue->lbadi,clue->lbadb,b);
-	    dump_pos(stdout, pos, clue->length);
-        }
+	x= (w + ws < bw_nword) ? src[w + ws] >> bs : 0;
+	if (bs != 0 && w + ws + 1 < bw_nword)
+	    x|= src[w + ws + 1] << (_bit_intsiz - bs);
+	dst[w]= x;
     }
-    else
-    {
-    	/* A cell in a block has been set to different color. */
-	b= clue->lbadb/2;
-	if (D)
-	    printf("L: OLD INVALID AT %d INT %d (BLOCK) -- ",
-		clue->lbadi,clue->lbadb);
+}
 
-	if ((cov[b] < 0 || cov[b] > clue->lbadi) &&
-		(!multicolor || may_be_bg(cell[clue->lbadi])))
-	{
-	    /* Block covers nothing or covered cells are right of changed cell,
-	     * and changed cell can be background color, so we just skip past
-	     * it */
-	    pos[b]= clue->lbadi + 1;
-	    if (cell[pos[b]] == NULL)
-	    {
-		clue->lbadb= -1;
-		return FAIL;
-	    }
-	    currcolor= clue->color[b];
-	    state= PLACEBLOCK;
-	    if (D)
-		printf("PLACEBLOCK %d AT %d\n   ",b,pos[b]);
-	}
-	else
-	{
-	    /* Block covers something, so we can't skip it ahead */
-	    state= BACKTRACK;
-	    if (D)
-		printf("BACKTRACK FROM BLOCK %d\n   ",b);
-	}
-	if (D)
-	    dump_pos(stdout, pos, clue->length);
-    }
 
-    backtracking= 0;
+/* Return the index of the first bit set in m at or after position i, or -1
+ * if there is none.
+ */
 
-    /* Finite State Machine */
+static line_t bw_next(bit_type *m, line_t i)
+{
+    int w= i / _bit_intsiz;
+    bit_type x;
 
-    while (state != HALT)
+    if (w >= bw_nword) return -1;
+    x= m[w] & (_bit_1s << (i % _bit_intsiz));
+    while (x == 0)
     {
-    	switch (state)
-	{
-	case NEWBLOCK:
+	if (++w >= bw_nword) return -1;
+	x= m[w];
+    }
+    return w * _bit_intsiz + bw_ctz(x);
+}
 
-	    /* Precondition: Blocks 0 through b-1 have been legally placed
-	     *    or b = 0.  If b > 0, then j is the index of the first cell
-	     *    after block b-1.
-	     * Action:  Begin placing block b after the previous one.
-	     */
 
-	    if (b >= clue->n)
-	    {
-		/* No blocks left.  Check rest of line to make sure it can
-		 * be blank.
-		 */
-		if (b-- == 0) j= 0;
-	    	state= CHECKREST; goto next;
-	    }
+/* Return the index of the last bit set in m at or before position i, or -1
+ * if there is none.
+ */
 
-	    currcolor= clue->color[b];	/* Color of current block */
-	    if (D)
-		printf("L: PLACING BLOCK %d COLOR %d LENGTH %d\n",
-		    b,currcolor,clue->length[b]==0?1:clue->length[b]);
+static line_t bw_prev(bit_type *m, line_t i)
+{
+    int w;
+    bit_type x;
 
-	    /* Earliest possible position of block b, after previous blocks,
-	     * leaving a space between the blocks if they are the same color.
-	     */
+    if (i < 0) return -1;
+    w= i / _bit_intsiz;
+    x= m[w] & (_bit_1s >> (_bit_intsiz - 1 - i % _bit_intsiz));
+    while (x == 0)
+    {
+	if (--w < 0) return -1;
+	x= m[w];
+    }
+    return w * _bit_intsiz + _bit_intsiz - 1 - bw_clz(x);
+}
 
-	    pos[b]= (b == 0) ? 0 :
-			j + ((clue->color[b-1] == currcolor) ? 1 : 0);
 
-	    if (cell[pos[b]] == NULL)
-	    {
-		/* No room for another block - fail */
-		clue->lbadb= -1;
-		return FAIL;
-	    }
+/* USE_BW - Return true if lro_solve() uses the bit-parallel solver for the
+ * given clue.  It handles two color lines without blotted clues, but is only
+ * used if selected with -aB, since it is slower than the state machines on
+ * the lines we have timed.
+ */
 
-	    if (D)
-		printf("L: FIRST POS %d\n",pos[b]);
+int use_bw(Clue *clue)
+{
+    return maybitwise && !multicolor && clue->lbcl == NULL;
+}
 
-	    state= PLACEBLOCK; goto next;
 
-	case PLACEBLOCK:
+/* Load line i of direction k into the bw_white, bw_black and bw_must masks.  The
+ * candidate masks for the blocks are computed only when needed.  On two color
+ * grids the white and black masks are just copied from the bitboard.
+ * left_solve_bw() and right_solve_bw() work on the line loaded by this.
+ */
 
-	    /* Precondition: Blocks 0 through b-1 have been legally placed
-	     *    or b = 0.  pos[b] points points to a position less than or
-	     *    equal to the position of block b.  currcolor is the color
-	     *    of the current block b.
-	     * Action:  Advance pos[b] until it points to a position where
-	     *    the next length[b] cells can all accomodate the block's
-	     *    color.  Also compute cov[b], the index of the leftmost
-	     *    cell covered by the block that cannot be background.
-	     */
+void bw_load(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t ncell= clue->linelen;
+    line_t j;
+    int w;
 
-	    /* First find a place for the first cell of the block, skipping
-	     * over white cells until we find one.
-	     */
+    bw_nword= bit_size((ncell + 1));
+    if (bitboard)
+    {
+	if (!bb_valid(sol)) load_bitboard(puz, sol);
+	memcpy(bw_white, bb_white(k,i), bw_nword * sizeof(bit_type));
+	memcpy(bw_black, bb_black(k,i), bw_nword * sizeof(bit_type));
+    }
+    else
+    {
+	memset(bw_white, 0, bw_nword * sizeof(bit_type));
+	memset(bw_black, 0, bw_nword * sizeof(bit_type));
+	for (j= 0; j < ncell; j++)
+	{
+	    if (may_be_bg(cell[j]))
+		bw_white[_bit_intn(j)]|= _bit_mask(j);
+	    if (may_be(cell[j], 1))
+		bw_black[_bit_intn(j)]|= _bit_mask(j);
+	}
+    }
 
-	    while (!may_be(cell[pos[b]], currcolor))
-	    {
-		if (D)
-		    printf("L: POS %d BLOCKED\n",pos[b]);
+    for (w= 0; w < bw_nword; w++)
+	bw_must[w]= ~bw_white[w];
+    bw_must[_bit_intn(ncell)]&= ~(_bit_1s << (ncell % _bit_intsiz));
+    for (w= _bit_intn(ncell) + 1; w < bw_nword; w++)
+	bw_must[w]= _bit_0s;
 
-		if (multicolor && !may_be_bg(cell[pos[b]]))
-		{
-		    /* We hit a cell that must be some color other
-		     * than the color of the current block.  Only hope is to
-		     * find a previously placed block that can be advanced to
-		     * cover it, so we backtrack.
-		     */
-		    if (D)
-			printf("L: BACKTRACKING ON WRONG COLOR\n",pos[b]);
-		    j= pos[b];
-		    while (b > 1 && !may_be(cell[j], clue->color[b-1]))
-			b--;
-		    state= BACKTRACK; goto next;
-		}
+    memset(bw_have, 0, clue->n);
+}
 
-		if (D)
-		    printf("L: SHIFT BLOCK TO %d\n",pos[b]+1);
 
-		if (cell[++pos[b]] == NULL)
-		{
-		    if (D)
-			printf("L: END OF THE LINE\n");
-		    clue->lbadb= -1;
-		    return FAIL;	/* Hit end of line */
-		}
-	    }
+/* Return the candidate mask for block b of the clue loaded by bw_load(),
+ * computing it if we haven't already.
+ */
 
-	    /* First cell has found a home, can we place the rest of the block?
-	     * While we are at at, compute cov[b].
-	     */
-	    if (D)
-		printf("L: FIRST CELL OF %d PLACED AT %d\n",b,pos[b]);
-	    j= pos[b];
-	    cov[b]= (may_be_bg(cell[j]) ? -1 : j);
+static bit_type *bw_candidates(Clue *clue, line_t b)
+{
+    bit_type *cand= bw_cand + b * bw_nword;
+    line_t len= clue->length[b];
+    line_t ncell= clue->linelen;
+    line_t have, s;
+    int w;
 
-	    bcl[b]= (clue->length[b] == 0) ? 1 : clue->length[b];
+    if (bw_have[b]) return cand;
+    bw_have[b]= 1;
 
-	    for (j++; j - pos[b] < bcl[b]; j++)
-	    {
-		if (D)
-		    printf("L: CHECKING CELL AT %d\n",j);
-		if (cell[j] == NULL)
-		{
-		    if (D)
-			printf("L: END OF THE LINE\n");
-		    clue->lbadb= -1;
-		    return FAIL;	/* Block runs off end of line */
-		}
+    /* Lines that fit in one word are most of them, so do those with plain
+     * shifts.  This is the same computation as below.
+     */
+    if (bw_nword == 1)
+    {
+	bit_type x= bw_black[0];
 
-		if (!may_be(cell[j], currcolor))
-		{
-		    if (D)
-			printf("L: FAILED AT %d\n",j);
-		    if (cov[b] == -1)
-		    {
-			/* block doesn't fit here, but it wasn't
-			 * covering anything, so just keep shifting it
-			 */
-			if (D)
-			    printf("L: SKIP AHEAD\n");
-			pos[b]= j;
-			state= PLACEBLOCK; goto next;
-		    }
-		    else
-		    {
-			/* Block b cannot be placed.  Need to try advancing
-			 * block b-1.
-			 */
-			if (D)
-			    printf("L: BACKTRACK\n");
-			state= BACKTRACK; goto next;
-		    }
-		}
+	for (have= 1; have < len; have+= s)
+	{
+	    s= (len - have < have) ? len - have : have;
+	    x&= x >> s;
+	}
+	x&= (bw_white[0] | _bit_mask(ncell)) >> len;
+	x&= (bw_white[0] << 1) | 1;
+	cand[0]= x;
+	return cand;
+    }
 
-		/* Update cov[b] */
-		if (cov[b] == -1 && !may_be_bg(cell[j]))
-		    cov[b]= j;
+    /* Start with all positions where the first cell may be black */
+    memcpy(cand, bw_black, bw_nword * sizeof(bit_type));
 
-		if (D)
-		    printf("L: OK AT %d (cov=%d)\n",j, cov[b]);
-	    }
+    /* Narrow to positions where the first len cells may be black, doubling
+     * the length of the run we have checked on each pass.
+     */
+    for (have= 1; have < len; have+= s)
+    {
+	s= (len - have < have) ? len - have : have;
+	bw_shift_down(bw_tmp, cand, s);
+	for (w= 0; w < bw_nword; w++)
+	    cand[w]&= bw_tmp[w];
+    }
 
-	    state= FINALSPACE; goto next;
+    /* The cell after the block must be able to be white, or be the end of
+     * the line.
+     */
+    bw_white[_bit_intn(ncell)]|= _bit_mask(ncell);
+    bw_shift_down(bw_tmp, bw_white, len);
+    bw_white[_bit_intn(ncell)]&= ~_bit_mask(ncell);
+    for (w= 0; w < bw_nword; w++)
+	cand[w]&= bw_tmp[w];
+
+    /* The cell before the block must be able to be white, or be the start
+     * of the line.
+     */
+    for (w= bw_nword - 1; w > 0; w--)
+	cand[w]&= (bw_white[w] << 1) | (bw_white[w-1] >> (_bit_intsiz - 1));
+    cand[0]&= (bw_white[0] << 1) | 1;
 
-	case FINALSPACE:
+    return cand;
+}
 
-	    /* Precondition: Blocks 0 through b-1 have been legally placed
-	     *    or b = 0.  pos[b] points points to a position so that all
-	     *    cells of the block can accomodate the block's color.  j
-	     *    is the index of the first cell after the block.  currcolor
-	     *    is the color of the current block b.
-	     * Action:  Check if the first cell after the block is a legal
-	     *    color.  If it is the same color as the block, try advancing
-	     *    the block to cover that too.  If backtracking is true,
-	     *    also ensure the block covers something, and advance it until
-	     *	  it does.
-	     */
 
-	    if (D)
-		printf("L: CHECKING FINAL SPACE\n");
+/* Find the left-most solution for the line loaded by bw_load().  Arguments
+ * and return values are as for left_solve().
+ *
+ * The pos[] array holds a lower bound on the position of each block, which
+ * we only ever increase.  If we have an old saved solution, then even if it
+ * has been invalidated, it is still a lower bound, since cells have only
+ * been narrowed since it was computed, so we start from that.
+ */
 
-	    if (cell[j] != NULL)
-	    {
-		/* OK, we've found a place the block fits, now we check that
-		 * first cell AFTER the block is able to be some color
-		 * different than the block's color.
-		 *
-		 * nextcolor is a color the next cell can be other than
-		 * BGCOLOR. In multicolor puzzles it is the color of the next
-		 * clue (if it is a different color). If there is no such
-		 * color it is just set to BGCOLOR.
-		 */
-		nextcolor= (multicolor &&
-			(b < clue->n - 1) &&
-			(currcolor != clue->color[b+1])) ?
-			    clue->color[b+1] : BGCOLOR;
+int left_solve_bw(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	int savepos, line_t **ppos, line_t **pbcl)
+{
+    Clue *clue= &puz->clue[k][i];
+    line_t ncell= clue->linelen;
+    line_t *pos, *cov;
+    line_t b, s, p, f, gap;
 
-		if (D)
-		    printf("L:  NEXTCOLOR=%d\n",nextcolor);
+    pos= (savepos) ? clue->lpos : lpos;
+    pos[clue->n]= -1;
+    *ppos= pos;
+    *pbcl= clue->length;
+    cov= savepos ? clue->lcov : gcov;
 
-		while (cell[j] != NULL && !may_be_bg(cell[j]) &&
-			(nextcolor == BGCOLOR || !may_be(cell[j],nextcolor)))
-		{
-		    /* Next cell is wrong color - our strategy is different
-		     * for regular blocks and blotted blocks.
-		     */
-		    if (D)
-			printf("L: NO FINAL SPACE\n");
-		    if (clue->length[b] == 0)
-		    {
-			/* For blotted clue blocks, we try stretching
-			 * the block to cover the cell.
-			 */
-			if (multicolor && !may_be(cell[j],currcolor))
-			{
-			    /* can't stretch the block.  BACKTRACK */
-			    state= BACKTRACK; goto next;
-			}
-			/* All's OK - go ahead and stretch the block */
-			bcl[b]++;
-
-			if (D) printf("L: STRETCHING BLOCK TO %d",bcl[b]);
-		    }
-		    else
-		    {
-			/* For normal blocks, we try advancing the block one
-			 * cell. But we need to make sure that we don't
-			 * uncover any cells, and we need to make sure that
-			 * the cell at the end is one we can cover. Note that
-			 * we never advance blotted-clue blocks, because we
-			 * want them at their leftmost possible starting
-			 * position, and so stretching them is always a
-			 * better option.
-			 */
-			if (cov[b] == pos[b] ||
-			    (multicolor && !may_be(cell[j],currcolor)) )
-			{
-			    /* can't advance.  BACKTRACK */
-			    state= BACKTRACK; goto next;
-			}
-			/* All's OK - go ahead and advance the block */
-			pos[b]++;
-
-			if (D) printf("L: ADVANCING BLOCK TO %d",pos[b]);
-		    }
-
-		    /* Succeeded in covering the cell either by stretching or
-		     * advancing the current block. Update coverage record.
-		     */
-		    if (cov[b] == -1 && !may_be_bg(cell[j]))
-			cov[b]= j;
-		    if (D) printf(" (cov=%d)\n",cov[b]);
-		    j++;
-		}
-	    }
+    if (savepos && clue->lbadb == MAXLINE)
+    {
+	if (D)
+	{
+	    printf("L: OLD STILL VALID -- REUSING: ");
+	    dump_pos(stdout, pos, clue->length);
+	}
+	return SUCCESS;
+    }
 
-	    /* At this point, we have successfully placed the block */
+    if (!savepos || clue->lbadb == -1)
+    {
+	if (D)
+	    printf("L: NO OLD -- FRESH BIT-PARALLEL START\n");
+	for (b= 0; b < clue->n; b++)
+	    pos[b]= 0;
+    }
+    else if (D)
+	printf("L: OLD INVALID AT %d -- BIT-PARALLEL RESTART\n", clue->lbadi);
 
-	    /* If we are advancing a block after backtracking, it needs to
-	     * cover something.
-	     */
-	    if (backtracking && cov[b] == -1)
+    b= 0;
+    while (b <= clue->n)
+    {
+	/* gap is the first cell after block b-1.  Find the first place
+	 * block b can go at or after its lower bound.
+	 */
+	gap= (b == 0) ? 0 : pos[b-1] + clue->length[b-1];
+	if (b == clue->n)
+	    p= ncell;
+	else
+	{
+	    s= (b == 0) ? 0 : gap + 1;
+	    if (pos[b] > s) s= pos[b];
+	    if ((p= bw_next(bw_candidates(clue,b), s)) < 0)
 	    {
 		if (D)
-		    printf("L: BACKTRACK BLOCK COVERS NOTHING\n",cov[b]);
-		backtracking= 0;
-		state= ADVANCEBLOCK; goto next;
+		    printf("L: NO PLACE FOR BLOCK %d AFTER %d\n",b,s);
+		if (savepos) clue->lbadb= -1;
+		return FAIL;
 	    }
+	}
 
-	    if (cell[j] == NULL && b < clue->n - 1)
+	/* If that would leave a black cell uncovered between block b-1 and
+	 * block b, then block b-1 must be advanced to cover it.
+	 */
+	f= bw_next(bw_must, gap);
+	if (f >= 0 && f < p)
+	{
+	    if (b == 0)
 	    {
-		/* Ran out of space, but still have blocks left */
-		clue->lbadb= -1;
+		if (D)
+		    printf("L: CELL %d CANNOT BE COVERED\n",f);
+		if (savepos) clue->lbadb= -1;
 		return FAIL;
 	    }
+	    b--;
+	    pos[b]= f - clue->length[b] + 1;
+	    if (D)
+		printf("L: ADVANCE BLOCK %d TO %d TO COVER %d\n",b,pos[b],f);
+	    continue;
+	}
 
-	    /* Successfully placed block b - Go on to next block */
-	    b++;
-	    backtracking= 0;
-	    state= NEWBLOCK; goto next;
+	if (b == clue->n) break;
+	pos[b]= p;
+	if (D)
+	    printf("L: PLACED BLOCK %d AT %d\n",b,p);
+	b++;
+    }
 
-	case CHECKREST:
+    for (b= 0; b < clue->n; b++)
+    {
+	f= bw_next(bw_must, pos[b]);
+	cov[b]= (f >= 0 && f < pos[b] + clue->length[b]) ? f : -1;
+    }
 
-	    /* Precondition: All blocks have been legally placed.  j points
-	     *   to first empty space after last block.  b is the index of
-	     *   the last block, or -1 if there are no blocks.
-	     * Action:  Check that there are no cells after the last block
-	     *   which cannot be left background color.
-	     */
-
-	    if (cell[j] != NULL)
-	    {
-		if (D)
-		    printf("L: PLACED LAST BLOCK - CHECK REST OF LINE\n");
-
-		for (; cell[j] != NULL; j++)
-		{
-		    if (D)
-			printf("L: CELL %d ",j);
-		    if (!may_be_bg(cell[j]))
-		    {
-			/* Check if we can cover the uncovered square by sliding
-			 * the last block right far enough to cover it. (If it's
-			 * a blotted clue block, we will stretch it instead.)
-			 */
-			if (D)
-			    printf("NEEDS COVERAGE\n");
-			j= pos[b] + bcl[b];
-			state= ADVANCEBLOCK; goto next;
-		    }
-		    else if (D)
-			printf("OK\n");
-		}
-	    }
-
-	    state= HALT; goto next;
-
-	case BACKTRACK:
-
-	    /* Precondition: Blocks 0 through b-1 have been legally placed,
-	     *   but block b cannot be.
-	     * Action:  Try to advance (or stretch) block b-1 so that it
-	     *   covers something new that can't be background color,
-	     *   without uncovering anything that it previously covered.
-	     */
-
-	    if (--b < 0)
-	    {
-		if (D)
-		    printf("L: NO BLOCKS LEFT TO BACKTRACK TO - FAIL\n");
-		clue->lbadb= -1;
-		return FAIL;
-	    }
-
-	    /* Point j to first cell after end of block */
-	    j= pos[b] + bcl[b];
-	    currcolor= clue->color[b];	/* Color of current block */
-
-	    if (D)
-		printf("L: BACKTRACKING: ");
-
-	    state= ADVANCEBLOCK; goto next;
-
-	case ADVANCEBLOCK:
-
-	    /* Precondition: Blocks 0 through b have been legally placed.
-	     *   j points to the first cell after block b.  currcolor is the
-	     *   color of block b.
-	     * Action:  Try to advance block b so that it covers at least one
-	     *   new cell that can't be background color, without uncovering
-	     *   anything that block b previously covered. If the block is a
-	     *   blotted clue block, then we will prefer stretching it to
-	     *   advancing it.
-	     */
-
-	    if (D)
-		printf("L: ADVANCE BLOCK %d (j=%d,cc=%d,pos=%d,cov=%d)\n",
-		    b,j,currcolor,pos[b],cov[b]);
-
-	    while(clue->length[b] == 0 || cov[b] < 0 || pos[b] < cov[b])
-	    {
-		if (!may_be(cell[j], currcolor))
-		{
-		    if (D)
-			printf("L: ADVANCE HIT OBSTACLE ");
-		    if (cov[b] >= 0 || (multicolor && !may_be_bg(cell[j])))
-		    {
-			if (D)
-			    printf("- BACKTRACKING\n");
-			state= BACKTRACK; goto next;
-		    }
-		    else
-		    {
-			/* Hit something we can't advance over, but we aren't
-			 * covering anything either, so jump past the obstacle.
-			 */
-			pos[b]= j+1;
-			if (D)
-			    printf("- JUMPING pos=%d\n",pos[b]);
-			backtracking= 1;
-			state= PLACEBLOCK; goto next;
-		    }
-		}
-
-		/* Can advance.  Do it */
-		if (clue->length[b] == 0)
-		{
-		    bcl[b]++;
-		    if (D)
-			printf("- STRETCHING BLOCK %d TO %d\n",b,bcl[b]);
-		}
-		else
-		{
-		    pos[b]++;
-		    if (D)
-			printf("- ADVANCING BLOCK %d TO %d\n",b,pos[b]);
-		}
-
-		/* Check if we have covered anything.  If we have, we can
-		 * stop advancing
-		 */
-		if (!may_be_bg(cell[j++]))
-		{
-		    if (cov[b] == -1) cov[b]= j-1;
-		    if (D)
-		    	printf("L: COVERED NEW TARGET AT %d - BLOCK AT %d"
-				" LENGTH %d\n", j-1, pos[b], bcl[b]);
-		    state= FINALSPACE; goto next;
-		}
-		if (cell[j] == NULL)
-		{
-		    if (D)
-			printf("L: END OF LINE\n");
-		    clue->lbadb= -1;
-		    return FAIL;
-		}
-	    }
-
-	    /* If we drop out here, then we've advanced the block as far
-	     * as we can, but we haven't succeeded in covering anything new.
-	     * So backtrack further.
-	     */
-	    if (D)
-		printf("L: CAN'T ADVANCE\n");
-	    state= BACKTRACK;
-	    goto next;
-	}
-	next:;
-    }
-
-    if (D)
-	printf("L: DONE\n");
+    if (D)
+	printf("L: DONE\n");
 
     if (savepos)
     {
@@ -956,65 +879,32 @@ int left_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	if (DU)
 	    printf("L: SAVING AT %d\n",clue->lstamp);
     }
-
     return SUCCESS;
 }
 
 
-/* Find rightmost solution for line i of clueset k
- *
- * On success, returns 0 and ppos and pbcl point to the solution. On
- * failure returns 1.  ppos points to array of ending indexes for blocks.
- * pbcl points to array which gives lengths of any blotted clues. These
- * arrays should not be freed by the calling program.
- *
- * This routine is structured as a finite state machine.  The state variable
- * 'state' selects between various states we might be in.  Each state has a
- * comment defining the precondition for that state.  This is basically a
- * trick to make old-fashioned spaghetti code look like it makes sense.
+/* Find the right-most solution for the line loaded by bw_load().  Arguments
+ * and return values are as for right_solve().  This is the mirror image of
+ * left_solve_bw(), with pos[] holding upper bounds on the last cell of each
+ * block.
  */
 
-int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
-	line_t **ppos, line_t **pbcl)
+int right_solve_bw(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	int savepos, line_t **ppos, line_t **pbcl)
 {
-    line_t b,j;
-    color_t currcolor, nextcolor;
-    int backtracking, state;
     Clue *clue= &puz->clue[k][i];
     line_t ncell= clue->linelen;
-    Cell **cell= sol->line[k][i];
-    line_t maxblock= clue->n - 1;
-    line_t *pos, *cov, *bcl;
-
-    /* The solution is constructed and returned in the pos and bcl arrays.
-     * The pos array contains current position of each block, or more
-     * specifically the rightmost cell of each block.  It's terminated by a -1.
-     * The bcl array is used only if we have blotted clues whose block
-     * length is variable. It gives the length of each blotted clue.
-     */
+    line_t *pos, *cov;
+    line_t b, e, q, f, gap;
+
     pos= (savepos) ? clue->rpos : rpos;
     pos[clue->n]= -1;
-    bcl= savepos ? (clue->rbcl != NULL ? clue->rbcl : clue->length) : rbcl;
     *ppos= pos;
-    *pbcl= bcl;
-
-    /* The cov array contains the index of the right-most cell covered by the
-     * block which CANNOT be white.  It is -1 if there is no such cell.
-     */
+    *pbcl= clue->length;
     cov= savepos ? clue->rcov : gcov;
 
-    if (!savepos || clue->rbadb == -1)
-    {
-    	/* no usable saved solution.  Start fresh. */
-	b= maxblock;
-	state= NEWBLOCK;
-	if (D)
-	    printf("L: NO OLD -- FRESH START\n");
-    }
-    else if (clue->rbadb == MAXLINE)
+    if (savepos && clue->rbadb == MAXLINE)
     {
-    	/* Can reuse old solution completely.  Note that we don't update the
-	 * time stamp in this case.  */
 	if (D)
 	{
 	    printf("L: OLD STILL VALID -- REUSING: ");
@@ -1022,470 +912,71 @@ int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	}
 	return SUCCESS;
     }
-    else if (clue->rbadb % 2 == 0)
-    {
-    	/* A cell in a gap was set to a non-background color.  Point b to
-	 * the preceding block, and start backtracking.  */
-	b= clue->rbadb/2 - 1;
-	state= BACKTRACK;
-	if (D)
-	{
-	    printf("L: OLD INVALID AT %d INT %d (GAP) "
-		"-- BACKTRACK FROM BLOCK %d\n   ", clue->rbadi,clue->rbadb,b);
-	    dump_pos(stdout, pos, clue->length);
-	}
-    }
-    else
-    {
-    	/* A cell in a block has been set to different color. */
-	b= clue->rbadb/2;
-	if (D)
-	    printf("L: OLD INVALID AT %d INT %d (BLOCK) -- ",
-		clue->rbadi,clue->rbadb);
 
-	if (cov[b] < clue->rbadi &&
-	    (!multicolor || may_be_bg(cell[clue->rbadi])))
-	{
-	    /* Block covers nothing, or covered cells are left of changed cell,
-	     * and changed cell can be background color, so we just skip past
-	     * it */
-	    pos[b]= clue->rbadi - 1;
-	    if (pos[b] < 0)
-	    {
-		clue->rbadb= -1;
-		return FAIL;
-	    }
-	    currcolor= clue->color[b];
-	    state= PLACEBLOCK;
-	    if (D)
-		printf("PLACEBLOCK %d AT %d\n   ",b,pos[b]);
-	}
-	else
-	{
-	    /* Block covers something, so we can't skip it ahead */
-	    state= BACKTRACK;
-	    if (D)
-		printf("BACKTRACK FROM BLOCK %d\n   ",b);
-	}
+    if (!savepos || clue->rbadb == -1)
+    {
 	if (D)
-	    dump_pos(stdout, pos, clue->length);
+	    printf("L: NO OLD -- FRESH BIT-PARALLEL START\n");
+	for (b= 0; b < clue->n; b++)
+	    pos[b]= ncell - 1;
     }
+    else if (D)
+	printf("L: OLD INVALID AT %d -- BIT-PARALLEL RESTART\n", clue->rbadi);
 
-    backtracking= 0;
-
-    /* Finite State Machine */
-
-    while (state != HALT)
+    b= clue->n - 1;
+    while (b >= -1)
     {
-    	switch (state)
+	/* gap is the last cell before block b+1.  Find the last place
+	 * block b can end at or before its upper bound.
+	 */
+	gap= (b == clue->n - 1) ? ncell - 1 : pos[b+1] - clue->length[b+1];
+	if (b == -1)
+	    q= -1;
+	else
 	{
-	case NEWBLOCK:
-
-	    /* Precondition: Blocks b+1 through maxblock have been legally
-	     *    placed or b = maxblock.  If b < maxblock, then j is the
-	     *    index of the first cell left of block b+1.
-	     * Action:  Begin placing block b after the previous one.
-	     */
-
-	    if (b < 0)
-	    {
-		/* No blocks left.  Check rest of line to make sure it can
-		 * be blank.
-		 */
-		if (b++ == maxblock) j= ncell - 1;
-	    	state= CHECKREST; goto next;
-	    }
-
-	    currcolor= clue->color[b];	/* Color of current block */
-	    if (D)
-		printf("L: PLACING BLOCK %d COLOR %d LENGTH %d\n",
-		    b,currcolor,clue->length[b]==0?1:clue->length[b]);
-
-	    /* Earliest possible position of block b, after previous blocks,
-	     * leaving a space between the blocks if they are the same color.
-	     */
-
-	    pos[b]= (b == maxblock) ? ncell - 1 :
-			j - ((clue->color[b+1] == currcolor) ? 1 : 0);
-
-	    if (pos[b] - (clue->length[b]==0?1:clue->length[b]) + 1 < 0)
+	    e= (b == clue->n - 1) ? ncell - 1 : gap - 1;
+	    if (pos[b] < e) e= pos[b];
+	    if ((q= bw_prev(bw_candidates(clue,b), e - clue->length[b] + 1)) < 0)
 	    {
-		/* No room for another block - fail */
-		clue->rbadb= -1;
-		return FAIL;
-	    }
-
-	    if (D)
-		printf("L: FIRST POS %d\n",pos[b]);
-
-	    state= PLACEBLOCK; goto next;
-
-	case PLACEBLOCK:
-
-	    /* Precondition: Blocks b+1 through maxblock have been legally
-	     *   placed or b = maxblock.  pos[b] points points to a position
-	     *   greater than or equal to the position of block b.  currcolor
-	     *   is the color of the current block b.
-	     * Action:  Advance pos[b] until it points to a position where
-	     *   the next length[b] cells can all accomodate the block's
-	     *   color.  Also compute cov[b], the index of the rightmost
-	     *   cell covered by the block that cannot be background.
-	     */
-
-	    /* First find a place for the first cell of the block, skipping
-	     * over white cells until we find one.
-	     */
-
-	    while (!may_be(cell[pos[b]], currcolor))
-	    {
-		if (D)
-		    printf("L: POS %d BLOCKED\n",pos[b]);
-
-		if (multicolor && !may_be_bg(cell[pos[b]]))
-		{
-		    /* We hit a cell that must be some color other
-		     * than the color of the current block.  Only hope is to
-		     * find a previously placed block that can be advanced to
-		     * cover it, so we backtrack.
-		     */
-		    if (D)
-			printf("L: BACKTRACKING ON WRONG COLOR\n",pos[b]);
-		    j= pos[b];
-		    while (b < maxblock-1 && !may_be(cell[j], clue->color[b+1]))
-			b++;
-		    state= BACKTRACK; goto next;
-		}
-
 		if (D)
-		    printf("L: SHIFT BLOCK TO %d\n",pos[b]-1);
-
-		if (--pos[b] < 0)
-		{
-		    if (D)
-			printf("L: END OF THE LINE\n");
-		    clue->rbadb= -1;
-		    return FAIL;	/* Hit end of line */
-		}
-	    }
-
-	    /* First cell has found a home, can we place the rest of the block?
-	     * While we are at at, compute cov[b].
-	     */
-	    if (D)
-		printf("L: FIRST CELL OF %d PLACED AT %d\n",b,pos[b]);
-	    j= pos[b];
-	    cov[b]= (may_be_bg(cell[j]) ? -1 : j);
-
-	    bcl[b]= (clue->length[b] == 0) ? 1 : clue->length[b];
-
-	    for (j--; pos[b] - j < bcl[b]; j--)
-	    {
-		if (D)
-		    printf("L: CHECKING CELL AT %d\n",j);
-		if (j < 0)
-		{
-		    if (D)
-			printf("L: END OF THE LINE\n");
-		    clue->rbadb= -1;
-		    return FAIL;	/* Block runs off end of line */
-		}
-
-		if (!may_be(cell[j], currcolor))
-		{
-		    if (D)
-			printf("L: FAILED AT %d\n",j);
-		    if (cov[b] == -1)
-		    {
-			/* block doesn't fit here, but it wasn't
-			 * covering anything, so just keep shifting it
-			 */
-			if (D)
-			    printf("L: SKIP AHEAD\n");
-			pos[b]= j;
-			state= PLACEBLOCK; goto next;
-		    }
-		    else
-		    {
-			/* Block b cannot be placed.  Need to try advancing
-			 * block b+1.
-			 */
-			if (D)
-			    printf("L: BACKTRACK\n");
-			state= BACKTRACK; goto next;
-		    }
-		}
-
-		/* Update cov[b] */
-		if (cov[b] == -1 && !may_be_bg(cell[j]))
-		    cov[b]= j;
-
-		if (D)
-		    printf("L: OK AT %d (cov=%d)\n",j, cov[b]);
-	    }
-
-	    state= FINALSPACE; goto next;
-
-	case FINALSPACE:
-
-	    /* Precondition: Blocks maxblock through b+1 have been legally
-	     *    placed or b = maxblock.  pos[b] points points to a position
-	     *    so that all cells of the block can accomodate the block's
-	     *    color.  j is the index of the first cell after the block.
-	     *    currcolor is the color of the current block b.
-	     * Action:  Check if the first cell after the block is a legal
-	     *    color.  If it is the same color as the block, try advancing
-	     *    the block to cover that too.  If backtracking is true,
-	     *    also ensure the block covers something, and advance it until
-	     *	  it does.
-	     */
-
-	    if (D)
-		printf("L: CHECKING FINAL SPACE\n");
-
-	    if (j >= 0)
-	    {
-		/* OK, we've found a place the block fits, now we check that
-		 * first cell AFTER the block is able to be some color different
-		 * than the block's color.
-		 *
-		 * nextcolor is a color the next cell can be other than
-		 * BGCOLOR. In multicolor puzzles it is the color of the next
-		 * clue (if it is a different color). If there is no such
-		 * color it is just set to BGCOLOR.
-		 */
-		nextcolor= (multicolor &&
-			(b > 0) &&
-			(currcolor != clue->color[b-1])) ?
-			    clue->color[b-1] : BGCOLOR;
-
-		if (D)
-		    printf("L:  NEXTCOLOR=%d\n",nextcolor);
-
-		while (j >= 0 && !may_be_bg(cell[j]) &&
-			(nextcolor == BGCOLOR || !may_be(cell[j],nextcolor)))
-		{
-		    /* Next cell is wrong color - our strategy is different
-		     * for regular blocks and blotted blocks. */
-		    if (D)
-			printf("L: NO FINAL SPACE\n");
-		    if (clue->length[b] == 0)
-		    {
-			/* For blotted clue blocks, we try stretching
-			 * the block to cover the cell. */
-			if (multicolor && !may_be(cell[j],currcolor))
-			{
-			    /* can't stretch the block.  BACKTRACK */
-			    state= BACKTRACK; goto next;
-			}
-			/* All's OK - go ahead and stretch the block */
-			bcl[b]++;
-
-			if (D) printf("L: STRETCHING BLOCK TO %d",bcl[b]);
-		    }
-		    else
-		    {
-			/* For normal blocks, we try advancing the block one
-			 * cell.  But we need to make sure that we don't
-			 * uncover any cells, and we need to make sure that
-			 * the cell at the end is one we can cover. Note that
-			 * we never advance blotted-clue blocks, because
-			 * we want them at their rightmost possible starting
-			 * position, so stretching them is always the
-			 * prefered option.
-			 */
-			if (cov[b] == pos[b] ||
-			    (multicolor && !may_be(cell[j],currcolor)) )
-			{
-			    /* can't advance.  BACKTRACK */
-			    state= BACKTRACK; goto next;
-			}
-			/* All's OK - go ahead and advance the block */
-			pos[b]--;
-
-			if (D) printf("L: ADVANCING BLOCK TO %d",pos[b]);
-		    }
-
-		    /* Succeeded in covering the cell either by stretching or
-		     * advancing the current block. Update coverage record. */
-		    if (cov[b] == -1 && !may_be_bg(cell[j]))
-			cov[b]= j;
-		    if (D) printf(" (cov=%d)\n",cov[b]);
-		    j--;
-		}
-	    }
-
-	    /* At this point, we have successfully placed the block */
-
-	    /* If we are advancing a block after backtracking, it needs to
-	     * cover something.
-	     */
-	    if (backtracking && cov[b] == -1)
-	    {
-		if (D)
-		    printf("L: BACKTRACK BLOCK COVERS NOTHING\n",cov[b]);
-		backtracking= 0;
-		state= ADVANCEBLOCK; goto next;
-	    }
-
-	    if (j < 0 && b > 0)
-	    {
-		/* Ran out of space, but still have blocks left */
-		clue->rbadb= -1;
+		    printf("L: NO PLACE FOR BLOCK %d BEFORE %d\n",b,e);
+		if (savepos) clue->rbadb= -1;
 		return FAIL;
 	    }
+	    q+= clue->length[b] - 1;
+	}
 
-	    /* Successfully placed block b - Go on to next block */
-	    b--;
-	    backtracking= 0;
-	    state= NEWBLOCK; goto next;
-
-	case CHECKREST:
-
-	    /* Precondition: All blocks have been legally placed.  j points
-	     *   to first empty space before last block.  b is the index of
-	     *   the last block, or -1 if there are no blocks.
-	     * Action:  Check that there are no cells before the last block
-	     *   which cannot be left background color.
-	     */
-
-	    if (j >= 0)
-	    {
-		if (D)
-		    printf("L: PLACED LAST BLOCK - CHECK REST OF LINE\n");
-
-		for (; j >= 0; j--)
-		{
-		    if (D)
-			printf("L: CELL %d ",j);
-		    if (!may_be_bg(cell[j]))
-		    {
-			/* Check if we can cover the uncovered square by sliding
-			 * the last block right far enough to cover it. (If it's
-			 * a blotted lue, we will stretch it instead.)
-			 */
-			if (D)
-			    printf("NEEDS COVERAGE (cov=%d j=%d)\n",cov[b],j);
-			j= pos[b] - bcl[b];
-			state= ADVANCEBLOCK; goto next;
-		    }
-		    else if (D)
-			printf("OK\n");
-		}
-	    }
-
-	    state= HALT; goto next;
-
-	case BACKTRACK:
-
-	    /* Precondition: Blocks maxblock through b+1 have been legally
-	     *   placed, but block b cannot be.
-	     * Action:  Try to advance (or stretch) block b+1 so that it
-	     *   covers something new that can't be background color,
-	     *   without uncovering anything that it previously covered.
-	     */
-
-	    if (++b > maxblock)
+	/* If that would leave a black cell uncovered between block b and
+	 * block b+1, then block b+1 must be advanced to cover it.
+	 */
+	f= bw_prev(bw_must, gap);
+	if (f > q)
+	{
+	    if (b == clue->n - 1)
 	    {
 		if (D)
-		    printf("L: NO BLOCKS LEFT TO BACKTRACK TO - FAIL\n");
-		clue->rbadb= -1;
+		    printf("L: CELL %d CANNOT BE COVERED\n",f);
+		if (savepos) clue->rbadb= -1;
 		return FAIL;
 	    }
-
-	    /* Point j to first cell before start of block */
-	    j= pos[b] - bcl[b];
-	    currcolor= clue->color[b];	/* Color of current block */
-
-	    if (D)
-		printf("L: BACKTRACKING: ");
-
-	    state= ADVANCEBLOCK; goto next;
-
-	case ADVANCEBLOCK:
-
-	    /* Precondition: Blocks maxblock through b+1 have been legally
-	     *   placed.  j points to the first cell before block b.
-	     *   currcolor is the color of block b.
-	     * Action:  Try to advance block b so that it covers at least one
-	     *   new cell that can't be background color, without uncovering
-	     *   anything that block b previously covered. If the block is a
-	     *   blotted clue block, then we will prefer stretching it to
-	     *   advancing it.
-	     */
-
+	    b++;
+	    pos[b]= f + clue->length[b] - 1;
 	    if (D)
-		printf("L: ADVANCE BLOCK %d (j=%d,cc=%d,pos=%d,cov=%d)\n",
-		    b,j,currcolor,pos[b],cov[b]);
-
-	    while(clue->length[b] == 0 || cov[b] < 0 || pos[b] > cov[b])
-	    {
-		if (!may_be(cell[j], currcolor))
-		{
-		    if (D)
-			printf("L: ADVANCE HIT OBSTACLE ");
-		    if (cov[b] >= 0 || (multicolor && !may_be_bg(cell[j])))
-		    {
-			if (D)
-			    printf("- BACKTRACKING\n");
-			state= BACKTRACK; goto next;
-		    }
-		    else
-		    {
-			/* Hit something we can't advance over, but we aren't
-			 * covering anything either, so jump past the obstacle.
-			 */
-			pos[b]= j-1;
-			if (D)
-			    printf("- JUMPING pos=%d\n",pos[b]);
-			backtracking= 1;
-			state= PLACEBLOCK; goto next;
-		    }
-		}
-
-		/* Can advance (or stretch).  Do it */
-		if (clue->length[b] == 0)
-		{
-		    bcl[b]++;
-		    if (D)
-			printf("- STRETCHING BLOCK %d TO %d\n",b,bcl[b]);
-		}
-		else
-		{
-		    pos[b]--;
-		    if (D)
-			printf("- ADVANCING BLOCK %d TO %d\n",b,pos[b]);
-		}
+		printf("L: ADVANCE BLOCK %d TO %d TO COVER %d\n",b,pos[b],f);
+	    continue;
+	}
 
-		/* Check if we have covered anything.  If we have, we can
-		 * stop advancing
-		 */
-		if (!may_be_bg(cell[j--]))
-		{
-		    if (cov[b] == -1) cov[b]= j+1;
-		    if (D)
-		    	printf("L: COVERED NEW TARGET AT %d - BLOCK AT %d"
-				" LENGTH %d\n", j+1, pos[b], bcl[b]);
-		    state= FINALSPACE; goto next;
-		}
-		if (j < 0)
-		{
-		    if (D)
-			printf("L: END OF LINE\n");
-		    clue->rbadb= -1;
-		    return FAIL;
-		}
-	    }
+	if (b == -1) break;
+	pos[b]= q;
+	if (D)
+	    printf("L: PLACED BLOCK %d AT %d\n",b,q);
+	b--;
+    }
 
-	    /* If we drop out here, then we've advanced the block as far
-	     * as we can, but we haven't succeeded in covering anything new.
-	     * So backtrack further.
-	     */
-	    if (D)
-		printf("L: CAN'T ADVANCE\n");
-	    state= BACKTRACK;
-	    goto next;
-	}
-	next:;
+    for (b= 0; b < clue->n; b++)
+    {
+	f= bw_prev(bw_must, pos[b]);
+	cov[b]= (f > pos[b] - clue->length[b]) ? f : -1;
     }
 
     if (D)
@@ -1498,7 +989,6 @@ int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	clue->rbadb= MAXLINE;
 	if (DU)
 	    printf("L: SAVING AT %d\n",clue->rstamp);
-
     }
     return SUCCESS;
 }
@@ -1514,9 +1004,56 @@ int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
  * solution.
  */
 
+/* NOTE_CHANGE - If the bitstring b has zeros for any colors that cell j of
+ * the line may still be, add the cell to the change list.
+ */
+
+static void note_change(Cell *cell, line_t j, bit_type *b)
+{
+    color_t z;
+
+    for (z= 0; z < fbit_size; z++)
+	if (cell->bit[z] & ~b[z]) break;
+    if (z == fbit_size) return;
+
+    chgidx[nchg]= j;
+    for (z= 0; z < fbit_size; z++)
+	chgbits(nchg)[z]= cell->bit[z] & b[z];
+    nchg++;
+}
+
+
+/* COL_CHANGES - Build the change list for line i in direction k from the
+ * result col of a line solver that returns a full column of bitstrings.
+ */
+
+static void col_changes(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	bit_type *col)
+{
+    line_t ncell= puz->clue[k][i].linelen;
+    Cell **cell= sol->line[k][i];
+    line_t j;
+
+    nchg= 0;
+    if (fbit_size == 1)
+    {
+	for (j= 0; j < ncell; j++)
+	    if (cell[j]->bit[0] & ~col[j])
+	    {
+		chgidx[nchg]= j;
+		chgbit[nchg++]= cell[j]->bit[0] & col[j];
+	    }
+    }
+    else
+	for (j= 0; j < ncell; j++)
+	    note_change(cell[j], j, colbit(j));
+}
+
+
 bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 {
     Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
     line_t ncell= clue->linelen;
     line_t nblock= clue->n;
     line_t *lpos, *rpos, *lbcl, *rbcl;
@@ -1524,19 +1061,40 @@ bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
     color_t c;
     line_t lb, rb;		/* Index of a block in lpos[] or rpos[] */
     int lgap,rgap;	/* If true, we are in gap before the indexed block */
+    int bitwise;	/* If true, use the bit-parallel solver */
+
+    /* Two color lines without blots may use the bit-parallel solver.  We
+     * don't need to load the line if both saved solutions are still good.
+     */
+    bitwise= use_bw(clue);
+    if (bitwise && (clue->lbadb != MAXLINE || clue->rbadb != MAXLINE))
+	bw_load(puz, sol, k, i);
 
     if (D)
 	printf("-----------------%s %d-LEFT------------------\n",
 		CLUENAME(puz->type,k),i);
-    if (left_solve(puz, sol, k, i, 1, &lpos, &lbcl))
+    if (bitwise ? left_solve_bw(puz, sol, k, i, 1, &lpos, &lbcl) :
+		  left_solve(puz, sol, k, i, 1, &lpos, &lbcl))
 	return NULL;
+    if (clue->lstale)
+    {
+	/* Stamp it as if it had just been found from scratch */
+	clue->lstamp= puz->nhist;
+	clue->lstale= 0;
+    }
 
     if (D)
 	printf("-----------------%s %d-RIGHT-----------------\n",
 		CLUENAME(puz->type,k),i);
-    if (right_solve(puz, sol, k, i, 1, &rpos, &rbcl))
+    if (bitwise ? right_solve_bw(puz, sol, k, i, 1, &rpos, &rbcl) :
+		  right_solve(puz, sol, k, i, 1, &rpos, &rbcl))
     	fail("Left solution but no right solution for %s %d\n",
 		cluename(puz->type,k), i);
+    if (clue->rstale)
+    {
+	clue->rstamp= puz->nhist;
+	clue->rstale= 0;
+    }
 
     if (D)
     {
@@ -1550,9 +1108,11 @@ bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 
     /* col is the array of bitstrings used to return values.  The i-th bit
      * string starts at col[fbit_size*i] and bits will be set to 1 for
-     * each color that cell i could be.
+     * each color that cell i could be.  Every cell's bitstring is written
+     * below, so it needs no clearing.  Cells that this narrows are put on
+     * the change list as we go.
      */
-    memset(col, 0, ncell * fbit_size * sizeof(bit_type));
+    nchg= 0;
 
     /* nbcolor is the number of blocks of each color we could be in */
     if (multicolor)
@@ -1593,18 +1153,20 @@ bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 	    /* If we are in the same interval both directions, then the
 	     * cell MUST be the color of that interval.
 	     */
-	    bit_set(colbit(j),lgap ? BGCOLOR : clue->color[lb]);
+	    fbit_setonly(colbit(j),lgap ? BGCOLOR : clue->color[lb]);
+	    if (cell[j]->n > 1) note_change(cell[j], j, colbit(j));
 	}
 	else if (multicolor)
 	{
-	    bit_set(colbit(j),BGCOLOR);
+	    fbit_setonly(colbit(j),BGCOLOR);
 	    for (c= 0; c < puz->ncolor; c++)
 	    	if (nbcolor[c] > 0)
 		    bit_set(colbit(j),c);
+	    if (cell[j]->n > 1) note_change(cell[j], j, colbit(j));
 	}
 	else
 	{
-	    /* Two color puzzles */
+	    /* Two color puzzles - nothing learned about this cell */
 	    fbit_setall(colbit(j));
 	}
     }
@@ -1619,9 +1181,324 @@ bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
 }
 
 
+/* PREPASS_PARTIAL - Try the simple rules on a partially known two color
+ * line, after prepass() has peeled the solved ends off.  The blocks b0
+ * through b1-1 must fit in cells lo through hi-1.  Each block is slid as far
+ * left as it can go without covering a white cell or touching a black one,
+ * and then as far right, giving a range of cells it must lie in.  Edge glue
+ * then trims the ranges of the first and last blocks to reach the first and
+ * last black cells.  Cells covered by a block at both ends of its range are
+ * black (simple boxes), and cells outside every range are white (simple
+ * spaces).  If that determines every cell and the result matches the clue,
+ * it is the only solution of the line, so it is what lro_solve() would find.
+ * Then we build the change list and return 1.  Otherwise we return 0.  The
+ * static lpos[] and rpos[] arrays hold the first and last cell of each
+ * block's range.
+ */
+
+static int prepass_partial(Clue *clue, Cell **cell, line_t lo, line_t hi,
+	line_t b0, line_t b1)
+{
+    line_t j, b, c, len, run, first, last;
+
+#define PP_WHITE(j) (cell[j]->n == 1 && may_be_bg(cell[j]))
+#define PP_BLACK(j) (!may_be_bg(cell[j]))
+
+    /* Slide the blocks left */
+    for (b= b0, j= lo; b < b1; b++, j+= 2)
+    {
+	len= clue->length[b];
+	for (run= 0; j < hi; j++)
+	    if (PP_WHITE(j))
+		run= 0;
+	    else if (++run >= len && (j + 1 == hi || !PP_BLACK(j+1)))
+		break;
+	if (j >= hi) return 0;
+	lpos[b]= j - len + 1;
+    }
+
+    /* Slide the blocks right */
+    for (b= b1, j= hi - 1; b > b0; b--, j-= 2)
+    {
+	len= clue->length[b-1];
+	for (run= 0; j >= lo; j--)
+	    if (PP_WHITE(j))
+		run= 0;
+	    else if (++run >= len && (j == lo || !PP_BLACK(j-1)))
+		break;
+	if (j < lo) return 0;
+	rpos[b-1]= j + len - 1;
+    }
+
+    /* Edge glue - the first block cannot end past the first black cell plus
+     * its length, nor the last block start before the last black cell less
+     * its length. */
+    for (first= lo; first < hi && !PP_BLACK(first); first++)
+	;
+    if (first < hi)
+    {
+	for (last= hi - 1; !PP_BLACK(last); last--)
+	    ;
+	if (rpos[b0] > first + clue->length[b0] - 1)
+	    rpos[b0]= first + clue->length[b0] - 1;
+	if (lpos[b1-1] < last - clue->length[b1-1] + 1)
+	    lpos[b1-1]= last - clue->length[b1-1] + 1;
+    }
+
+    for (b= b0; b < b1; b++)
+	if (rpos[b] - lpos[b] + 1 < clue->length[b]) return 0;
+
+    /* Sweep the line, working out each unknown cell and checking the
+     * resulting blocks against the clue.  Block b is the first one whose
+     * range has not ended before cell j, block c is the first one whose box
+     * has not, and block b0+run is the next one the line should show. */
+    nchg= 0;
+    b= c= b0;
+    run= len= 0;
+    for (j= lo; j <= hi; j++)
+    {
+	while (b < b1 && rpos[b] < j) b++;
+	while (c < b1 && lpos[c] + clue->length[c] - 1 < j) c++;
+	if (j == hi || PP_WHITE(j))
+	    ;
+	else if (cell[j]->n == 1)
+	{
+	    len++;
+	    continue;
+	}
+	else if (c < b1 && j >= rpos[c] - clue->length[c] + 1)
+	{
+	    add_change(j, clue->color[c]);
+	    len++;
+	    continue;
+	}
+	else if (b < b1 && lpos[b] <= j)
+	    return 0;
+	else
+	    add_change(j, BGCOLOR);
+
+	/* Cell j is white, so any block before it has ended */
+	if (len > 0)
+	{
+	    if (b0 + run >= b1 || clue->length[b0 + run] != len) return 0;
+	    run++;
+	    len= 0;
+	}
+    }
+    return (b0 + run == b1);
+
+#undef PP_WHITE
+#undef PP_BLACK
+}
+
+
+/* PREPASS - A cheap check run on two color lines without blots before the
+ * left/right overlap solver.  Solved cells and completely solved blocks are
+ * peeled off both ends of the line.  If what is left is entirely unknown
+ * cells, then the left-most and right-most solutions are just the remaining
+ * blocks packed against either end, and we can find their overlap directly.
+ * That covers lines that are completely solved, lines that have no blocks
+ * left or no slack left, and lines whose blocks are too short to overlap,
+ * which are most of the lines we get asked to solve.  If some of what is
+ * left is known, we return 0 unless partial is set, in which case
+ * prepass_partial() tries the simple rules on it.  That is slower, so it is
+ * only worth doing for lines the caches could not answer.  If the line is
+ * one of these, we build the change list and return 1.  Otherwise, or if
+ * anything looks like a contradiction, we return 0 and leave it to
+ * lro_solve().
+ */
+
+static int prepass(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	int partial)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t lo= 0, hi= clue->linelen;
+    line_t b0= 0, b1= clue->n;
+    line_t j, b, len, start, slack;
+
+    if (multicolor || clue->lbcl != NULL) return 0;
+    if (!partial) prepass_runs++;
+
+    /* Peel solved cells and blocks off the left end.  Cell lo is either
+     * white, or the first cell of block b0. */
+    while (lo < hi && cell[lo]->n == 1)
+    {
+	if (may_be_bg(cell[lo]))
+	{
+	    lo++;
+	    continue;
+	}
+	if (b0 == b1 || lo + (len= clue->length[b0]) > hi) return 0;
+	for (j= lo + 1; j < lo + len; j++)
+	    if (may_be_bg(cell[j])) return 0;
+	if (j < hi && (cell[j]->n > 1 || !may_be_bg(cell[j]))) return 0;
+	lo= j;
+	b0++;
+    }
+
+    /* Peel solved cells and blocks off the right end */
+    while (hi > lo && cell[hi-1]->n == 1)
+    {
+	if (may_be_bg(cell[hi-1]))
+	{
+	    hi--;
+	    continue;
+	}
+	if (b0 == b1 || hi - (len= clue->length[b1-1]) < lo) return 0;
+	for (j= hi - 2; j >= hi - len; j--)
+	    if (may_be_bg(cell[j])) return 0;
+	if (j >= lo && (cell[j]->n > 1 || !may_be_bg(cell[j]))) return 0;
+	hi= j + 1;
+	b1--;
+    }
+
+    /* If the rest of the line is not all unknown, try the simple rules */
+    if (bb_valid(sol))
+    {
+	if (!bb_all_unknown(k, i, lo, hi))
+	    return (partial && b0 < b1 &&
+		    prepass_partial(clue, cell, lo, hi, b0, b1));
+    }
+    else
+	for (j= lo; j < hi; j++)
+	    if (cell[j]->n == 1)
+		return (partial && b0 < b1 &&
+			prepass_partial(clue, cell, lo, hi, b0, b1));
+
+    nchg= 0;
+
+    /* If there are no blocks left, the rest of the line is white */
+    if (b0 == b1)
+    {
+	for (j= lo; j < hi; j++)
+	    add_change(j, BGCOLOR);
+	return 1;
+    }
+
+    /* Find the slack - the number of cells the remaining blocks can move */
+    slack= hi - lo + 1;
+    for (b= b0; b < b1; b++)
+	slack-= clue->length[b] + 1;
+    if (slack < 0) return 0;
+
+    /* Pack the blocks against the left end.  Cells covered by a block both
+     * there and when shifted right by the slack are black.  If there is no
+     * slack, the cells between the blocks are white.
+     */
+    for (start= lo, b= b0; b < b1; start+= len + 1, b++)
+    {
+	len= clue->length[b];
+	for (j= start + slack; j < start + len; j++)
+	    add_change(j, clue->color[b]);
+	if (slack == 0 && b < b1 - 1)
+	    add_change(start + len, BGCOLOR);
+    }
+    return 1;
+}
+
+
+/* Update line i in direction k to make the changes on the change list.
+ * Changed cells are saved in the history and jobs are created for crossing
+ * lines.  Returns the number of cells changed.
+ */
+
+static line_t apply_changes(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	int depth)
+{
+    Cell **cell= sol->line[k][i];
+    Cell *cj;
+    bit_type *new;
+    line_t j, n;
+
+    if (DW(k,i))
+	printf("L: UPDATING GRID\n");
+
+    for (n= 0; n < nchg; n++)
+    {
+	j= chgidx[n];
+	cj= cell[j];
+	new= chgbits(n);
+
+	/* Do probe merging (maybe) */
+	if (merging) merge_set(puz, cj, new);
+
+	if (VS || DW(k,i))
+	{
+	    if (DW(k,i))
+		printf("L: CELL %d,%d - CHANGED FROM (",
+			k == D_ROW ? i : j, k == D_ROW ? j : i);
+	    else
+		printf("S: CELL %d,%d CHANGED FROM (",
+			k == D_ROW ? i : j, k == D_ROW ? j : i);
+	    dump_bits(stdout, puz, cj->bit);
+	}
+
+	/* Save old value to history (maybe) */
+	add_hist(puz, cj, 0);
+
+	/* Copy new values into grid */
+	fbit_cpy(oldval, cj->bit);
+	fbit_cpy(cj->bit, new);
+	cell_changed(puz, cj, oldval);
+
+	if (VS || DW(k,i))
+	{
+	    printf(") TO (");
+	    dump_bits(stdout, puz, cj->bit);
+	    printf(")\n");
+	}
+
+	if (DW(k,i) && VJ)
+	    dump_history(stdout, puz, 0);
+
+	if (puz->ncolor <= 2)
+	    cj->n= 1;
+	else
+	    count_cell(puz,cj);
+
+	if (cj->n == 1)
+	    solved_a_cell(puz,cj,1);
+
+	/* Put other directions that use this cell on the job list */
+	add_jobs(puz, sol, k, cj, depth, oldval);
+    }
+    return nchg;
+}
+
+
+/* RECORD_LINE - Write the current state of line i in direction k to
+ * standard error, for use as a benchmark corpus by "testline -b".  The
+ * record is "R", the direction, the line number, and then the bitstring of
+ * each cell in hex, with colons between the words if there is more than one.
+ */
+
+static void record_line(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    line_t ncell= puz->clue[k][i].linelen;
+    Cell **cell= sol->line[k][i];
+    line_t j;
+    color_t z;
+
+    fprintf(stderr,"R %d %d",k,i);
+    for (j= 0; j < ncell; j++)
+    {
+	fprintf(stderr," %lx",(unsigned long)cell[j]->bit[0]);
+	for (z= 1; z < fbit_size; z++)
+	    fprintf(stderr,":%lx",(unsigned long)cell[j]->bit[z]);
+    }
+    fputc('\n',stderr);
+}
+
+
 /* Run the Left/Right Overlap algorithm on a line of the puzzle.  Update the
  * line to show the result, and create new jobs for crossing lines for changed
- * cells.  Returns 0 on success, 1 if there is a contradiction in the solution.
+ * cells.  If the settle solver is enabled and the line still has unsolved
+ * cells after that, run it too, to find anything the left/right overlap
+ * algorithm missed.  Lines that the pre-pass can handle skip all that, and
+ * short lines of two color puzzles are looked up in the line tables
+ * instead, if possible.  Returns 0 on success, 1 if there is a
+ * contradiction in the solution.
  */
 
 int apply_lro(Puzzle *puz, Solution *sol, dir_t k, line_t i, int depth)
@@ -1629,102 +1506,99 @@ int apply_lro(Puzzle *puz, Solution *sol, dir_t k, line_t i, int depth)
     bit_type *col;
     line_t ncell= puz->clue[k][i].linelen;
     Cell **cell= sol->line[k][i];
-    line_t j;
-    color_t z;
-    bit_type new, *old;
-    int newsol= 0;
+    line_t j, n;
+    int newsol= 0, found= 0;
+    int tabled= (tablelines && ncell <= LINETABLE_MAX);
+    int cached= 0, split= 0;
     line_t nchange= 0;
 
     if ((VC && VV) && depth > 0)
     	printf("C: SOLVING %s %d at DEPTH %d\n",
 	    CLUENAME(puz->type,k),i,depth-1);
 
-    /* First try finding the solution in the cache */
-    if (cachelines && (col= line_cache(puz, sol, k, i)) != NULL)
+    if (recordlines) record_line(puz, sol, k, i);
+
+    /* Everything below may change the saved left and right solutions */
+    trail_clue(&puz->clue[k][i]);
+
+    /* First see if the pre-pass can handle the line.  If not, try finding
+     * the solution in the line table or the cache, unless the cache has not
+     * been getting hits on this line lately.  With -aD, lines that miss and
+     * split into independent segments are looked up a segment at a time.
+     * Lines that miss get another try with the slower partial pre-pass. */
+    col= NULL;
+    if (prepass(puz, sol, k, i, 0))
+    {
+	prepass_skips++;
+	found= 1;
+    }
+    else if (tabled)
+	found= ((col= line_table(puz, sol, k, i)) != NULL);
+    else if (cachelines && !bypass_cache(k, i))
+    {
+	cached= 1;
+	found= ((col= line_cache(puz, sol, k, i)) != NULL);
+	if (!found && maysegment && (split= split_line(puz, sol, k, i)) > 0)
+	    found= ((col= segment_cache(puz, sol, k, i)) != NULL);
+    }
+    if (!found && prepass(puz, sol, k, i, 1))
+    {
+	prepass_skips++;
+	found= 1;
+    }
+
+    if (found)
     {
-	/* If found a cached solution invalidate old left/right solutions
+	/* If found a stored solution invalidate old left/right solutions
 	 * They might still be valid, or they might not.
 	 */
 	puz->clue[k][i].lbadb= -1;
 	puz->clue[k][i].rbadb= -1;
+	if (col != NULL) col_changes(puz, sol, k, i, col);
     }
     else
     {
-	/* If didn't find a solution from cache, Compute it */
+	/* If didn't find a stored solution, Compute it.  This builds the
+	 * change list itself. */
 	col= lro_solve(puz, sol, k, i);
 	if (col == NULL) return FAIL;
-	newsol= cachelines;
+	newsol= (tabled || cached);
     }
 
-    if (DW(k,i))
-	printf("L: UPDATING GRID\n");
+    nchange= apply_changes(puz, sol, k, i, depth);
 
-    for (j= 0; j < ncell; j++)
+    /* If the left/right overlap algorithm has stalled with cells still
+     * unsolved, see if the settle solver can do better.  Stored solutions
+     * were already settled when they were stored, and the pre-pass finds
+     * everything there is to find, so skip those.
+     */
+    if (maysettle && !found)
     {
-	/* Is the new value different from the old value? */
-	for (z= 0; z < fbit_size; z++)
+	for (j= 0; j < ncell; j++)
+	    if (cell[j]->n > 1) break;
+	if (j < ncell && puz->clue[k][i].lbcl == NULL)
 	{
-	    oldval[z]= cell[j]->bit[z];
-	    new= (colbit(j)[z] & cell[j]->bit[z]);
-	    if (cell[j]->bit[z] != new)
-	    {
-		nchange++;
-
-		/* Do probe merging (maybe) */
-		if (merging) merge_set(puz, cell[j], colbit(j));
-
-		if (VS || DW(k,i))
-		{
-		    if (DW(k,i))
-			printf("L: CELL %d,%d - BYTE %d - CHANGED FROM (",
-				k == D_ROW ? i : j, k == D_ROW ? j : i, z);
-		    else
-			printf("S: CELL %d,%d CHANGED FROM (",
-				k == D_ROW ? i : j, k == D_ROW ? j : i);
-		    dump_bits(stdout, puz, cell[j]->bit);
-		}
-
-		/* Save old value to history (maybe) */
-		add_hist(puz, cell[j], 0);
-
-		/* Copy new values into grid */
-		cell[j]->bit[z] = new;
-		for (z++; z < fbit_size; z++)
-		{
-		    oldval[z]= cell[j]->bit[z];
-		    cell[j]->bit[z]&= colbit(j)[z];
-		}
-
-		if (VS || DW(k,i))
-		{
-		    printf(") TO (");
-		    dump_bits(stdout, puz, cell[j]->bit);
-		    printf(")\n");
-		}
-
-		if (DW(k,i) && VJ)
-		    dump_history(stdout, puz, 0);
-
-		if (puz->ncolor <= 2)
-		    cell[j]->n= 1;
-		else
-		    count_cell(puz,cell[j]);
-
-		if (cell[j]->n == 1)
-		    solved_a_cell(puz,cell[j],1);
-
-		/* Put other directions that use this cell on the job list */
-		add_jobs(puz, sol, k, cell[j], depth, oldval);
-		break;
-	    }
-	    else
-		if (DW(k,i))
-		    printf("L: CELL %d - BYTE %d\n",j,z);
+	    settle_runs++;
+	    col= settle_solve(puz, sol, k, i);
+	    if (col == NULL) return FAIL;
+	    col_changes(puz, sol, k, i, col);
+	    n= apply_changes(puz, sol, k, i, depth);
+	    settle_cells+= n;
+	    nchange+= n;
 	}
     }
 
-    /* If we are caching and computed a new solution, cache it */
-    if (newsol) add_cache(puz, sol, k, i);
+    /* If we are caching and computed a new solution, store it */
+    if (newsol)
+    {
+	if (tabled)
+	    add_table(puz, sol, k, i);
+	else
+	{
+	    add_cache(puz, sol, k, i);
+	    if (split) add_segments(puz, sol, k, i);
+	}
+    }
 
     if (hintlog && nchange > 0)
     {
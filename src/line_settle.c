@@ -0,0 +1,259 @@
+/* Copyright 2012 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SETTLE LINE SOLVER - This is a complete line solver.  Where the left-right
+ * overlap algorithm only compares the left-most and right-most solutions of
+ * a line, this finds the exact set of colors each cell can have over all
+ * valid placements of the clue's blocks.  So it finds everything that
+ * try_everything() would find for the line, and it does it in a single pass.
+ *
+ * It's a dynamic programming algorithm over cells and blocks.  We do a
+ * forward pass that finds, for each prefix of the line and each number of
+ * blocks, whether those blocks can be placed in that prefix, and a backward
+ * pass that does the same for suffixes.  A block can then be at a position
+ * if it fits there and the prefix before it and the suffix after it can
+ * both be solved.  Cost is proportional to the line length times the number
+ * of blocks, which is more than the left-right overlap algorithm usually
+ * needs, so we only use this when that has stalled.
+ *
+ * Lines with blotted clues are not handled.  For those we return NULL.
+ */
+
+#include "pbnsolve.h"
+
+#define colbit(i) (col+(fbit_size*(i)))
+
+/* Work arrays, sized for the largest line and clue in the puzzle.
+ *
+ *   pre[b][j]  - first j cells can hold the first b blocks.
+ *   preg[b][j] - same, and cell j-1 is background (or j == 0).
+ *   suf[b][j]  - cells j and later can hold blocks b and later.
+ *   sufg[b][j] - same, and cell j is background (or j == ncell).
+ *   cnt[c][j]  - number of cells before j that may be color c.
+ *   cover[j]   - used to mark the cells covered by a block's placements.
+ */
+
+static byte *pre, *preg, *suf, *sufg;
+static line_t *cnt, *cover;
+static byte *hascolor;
+static bit_type *col;
+static int width;	/* Row size of the pre, preg, suf and sufg arrays */
+
+#define PRE(b,j)  pre[(b)*width + (j)]
+#define PREG(b,j) preg[(b)*width + (j)]
+#define SUF(b,j)  suf[(b)*width + (j)]
+#define SUFG(b,j) sufg[(b)*width + (j)]
+#define CNT(c,j)  cnt[(c)*width + (j)]
+
+/* Can block b of the clue be placed starting at cell j? */
+#define FITS(clue,b,j) \
+    (CNT((clue)->color[b], (j) + (clue)->length[b]) - \
+     CNT((clue)->color[b], (j)) == (clue)->length[b])
+
+
+/* Allocate the work arrays for the settle solver. */
+
+void init_settle(Puzzle *puz)
+{
+    line_t maxcluelen= 0, maxdimension= 0;
+    line_t i;
+    dir_t k;
+
+    for (k= 0; k < puz->nset; k++)
+    {
+	if (puz->n[k] > maxdimension) maxdimension= puz->n[k];
+	for (i= 0; i < puz->n[k]; i++)
+	    if (puz->clue[k][i].n > maxcluelen)
+		maxcluelen= puz->clue[k][i].n;
+    }
+
+    /* Free the arrays of any previous puzzle */
+    free(pre);
+    free(preg);
+    free(suf);
+    free(sufg);
+    free(cnt);
+    free(cover);
+    free(hascolor);
+    free(col);
+
+    width= maxdimension + 1;
+    pre= (byte *)malloc((maxcluelen + 1) * width);
+    preg= (byte *)malloc((maxcluelen + 1) * width);
+    suf= (byte *)malloc((maxcluelen + 1) * width);
+    sufg= (byte *)malloc((maxcluelen + 1) * width);
+    cnt= (line_t *)malloc(puz->ncolor * width * sizeof(line_t));
+    cover= (line_t *)malloc(width * sizeof(line_t));
+    hascolor= (byte *)malloc(puz->ncolor);
+    col= (bit_type *)malloc(maxdimension * fbit_size * sizeof(bit_type));
+}
+
+
+/* SETTLE_SOLVE - Find all colors that each cell of line i in direction k
+ * can be.  Returns a pointer to an array of bitstrings, in the same format as
+ * lro_solve() returns.  The calling program should NOT free this array.
+ * Returns NULL if there is no solution, or if the clue has blots.
+ */
+
+bit_type *settle_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    Clue *clue= &puz->clue[k][i];
+    Cell **cell= sol->line[k][i];
+    line_t ncell= clue->linelen;
+    line_t nb= clue->n;
+    line_t b, j, s, e, len, n;
+    color_t c;
+    int ok;
+
+    for (b= 0; b < nb; b++)
+	if (clue->length[b] == 0) return NULL;
+
+    /* Count the cells that may be each of the colors used in the clue */
+    memset(hascolor, 0, puz->ncolor);
+    for (b= 0; b < nb; b++)
+    {
+	c= clue->color[b];
+	if (hascolor[c]) continue;
+	hascolor[c]= 1;
+	CNT(c,0)= 0;
+	for (j= 0; j < ncell; j++)
+	    CNT(c,j+1)= CNT(c,j) + (may_be(cell[j],c) ? 1 : 0);
+    }
+
+    /* Forward pass over prefixes */
+    for (b= 0; b <= nb; b++)
+	PRE(b,0)= PREG(b,0)= (b == 0);
+    for (j= 1; j <= ncell; j++)
+    {
+	for (b= 0; b <= nb; b++)
+	{
+	    /* Cell j-1 is background */
+	    PREG(b,j)= PRE(b,j-1) && may_be_bg(cell[j-1]);
+	    ok= PREG(b,j);
+
+	    /* Cell j-1 is the last cell of block b-1 */
+	    if (!ok && b > 0 && (len= clue->length[b-1]) <= j)
+	    {
+		s= j - len;
+		if (FITS(clue, b-1, s))
+		{
+		    if (b == 1)
+			ok= PRE(0,s);
+		    else if (clue->color[b-2] == clue->color[b-1])
+			ok= PREG(b-1,s);
+		    else
+			ok= PRE(b-1,s);
+		}
+	    }
+	    PRE(b,j)= ok;
+	}
+    }
+
+    if (!PRE(nb,ncell))
+    {
+	if (VL)
+	    printf("L: SETTLE FOUND NO SOLUTION FOR %s %d\n",
+		CLUENAME(puz->type,k),i);
+	return NULL;
+    }
+
+    /* Backward pass over suffixes */
+    for (b= 0; b <= nb; b++)
+	SUF(b,ncell)= SUFG(b,ncell)= (b == nb);
+    for (j= ncell - 1; j >= 0; j--)
+    {
+	for (b= nb; b >= 0; b--)
+	{
+	    /* Cell j is background */
+	    SUFG(b,j)= SUF(b,j+1) && may_be_bg(cell[j]);
+	    ok= SUFG(b,j);
+
+	    /* Cell j is the first cell of block b */
+	    if (!ok && b < nb && (e= j + clue->length[b]) <= ncell &&
+		    FITS(clue, b, j))
+	    {
+		if (b == nb - 1)
+		    ok= SUF(nb,e);
+		else if (clue->color[b+1] == clue->color[b])
+		    ok= SUFG(b+1,e);
+		else
+		    ok= SUF(b+1,e);
+	    }
+	    SUF(b,j)= ok;
+	}
+    }
+
+    memset(col, 0, ncell * fbit_size * sizeof(bit_type));
+
+    /* A cell can be background if some number of blocks fit before it and
+     * the rest fit after it.
+     */
+    for (j= 0; j < ncell; j++)
+    {
+	if (!may_be_bg(cell[j])) continue;
+	for (b= 0; b <= nb; b++)
+	    if (PRE(b,j) && SUF(b,j+1))
+	    {
+		bit_set(colbit(j),BGCOLOR);
+		break;
+	    }
+    }
+
+    /* A cell can be the color of block b if some valid placement of block b
+     * covers it.  Mark the placements in the cover array, adding one at the
+     * start of each placement and subtracting one after its end.
+     */
+    for (b= 0; b < nb; b++)
+    {
+	c= clue->color[b];
+	len= clue->length[b];
+	memset(cover, 0, (ncell + 1) * sizeof(line_t));
+	for (s= 0; s + len <= ncell; s++)
+	{
+	    if (!FITS(clue, b, s)) continue;
+
+	    if (b == 0)
+		ok= PRE(0,s);
+	    else if (clue->color[b-1] == c)
+		ok= PREG(b,s);
+	    else
+		ok= PRE(b,s);
+	    if (!ok) continue;
+
+	    e= s + len;
+	    if (b == nb - 1)
+		ok= SUF(nb,e);
+	    else if (clue->color[b+1] == c)
+		ok= SUFG(b+1,e);
+	    else
+		ok= SUF(b+1,e);
+	    if (!ok) continue;
+
+	    cover[s]++;
+	    cover[e]--;
+	}
+	for (n= 0, j= 0; j < ncell; j++)
+	    if ((n+= cover[j]) > 0)
+		bit_set(colbit(j),c);
+    }
+
+    if (VL)
+    {
+	printf("L: SETTLE SOLUTION TO LINE %d DIRECTION %d\n",i,k);
+	dump_lro_solve(puz, k, i, col);
+    }
+
+    return col;
+}
@@ -0,0 +1,339 @@
+/* Copyright 2012 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* PERSISTENT LINE STORE - This is a second level behind the line cache in
+ * line_cache.c, kept in a file that is memory mapped, so that line solutions
+ * found in one run can be reused in later runs on the same or similar
+ * puzzles.  It is turned on by the -p option.
+ *
+ * The line cache is keyed by clue ids, which only mean something within one
+ * puzzle, so the store is keyed instead by a pair of hashes of the literal
+ * clue, the line length and the number of colors, along with the compressed
+ * line state, in the same form the line cache uses.  The value is the
+ * compressed state after line solving.  Lines whose compressed state doesn't
+ * fit in a slot are not stored.
+ *
+ * The file starts with a header giving a magic string, the format version,
+ * the word size, the number of words of line state in each slot, and the
+ * number of slots.  A file with a different version or layout is not used.
+ * The rest of the file is a hash table of fixed size slots.  Each key can go
+ * in any of the STORE_PROBES slots following its hash index.  If those are
+ * all full, a new entry replaces one of them.  Nothing is ever deleted.
+ *
+ * Any number of pbnsolve processes may use the same file at once.  The file
+ * is locked with flock() only while it is being created or its header is
+ * checked.  After that, each slot is protected by a sequence lock.  The first
+ * word of the slot is a counter which is odd while the slot is being written.
+ * Writers claim a slot by atomically bumping its counter from even to odd,
+ * and give up if they can't.  Readers check that the counter was even and
+ * unchanged across their copy of the slot, and treat it as a miss otherwise.
+ */
+
+#include "pbnsolve.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define STORE_MAGIC "PBNSTORE"
+#define STORE_VERSION 1
+
+typedef struct {
+    char magic[8];	/* STORE_MAGIC */
+    int version;	/* STORE_VERSION */
+    int wordsize;	/* sizeof(bit_type) */
+    int statewords;	/* Words of line state in each slot */
+    int pad1;
+    long nslots;	/* Number of slots in the table */
+    long pad2[4];
+} StoreHeader;
+
+/* Each slot is:
+ *
+ *   word 0                  - sequence lock counter
+ *   words 1-2               - the two clue hashes.  Zero if slot is empty.
+ *   next statewords words   - the line state before solving
+ *   next statewords words   - the line state after solving
+ */
+
+#define seqword(s) (s)
+#define key1(s) ((s)[1])
+#define key2(s) ((s)[2])
+#define oldst(s) ((s)+3)
+#define newst(s) ((s)+3+store_sw)
+
+static bit_type *store_slots;
+static long store_nslots;
+static int store_sw;		/* statewords from the header */
+static int store_ssize;		/* Words per slot */
+
+/* The two clue hashes for each line, in the orientation the line cache
+ * stores it in.  */
+static bit_type *store_key[2];
+
+/* Copy of a slot, for readers */
+static bit_type *copy;
+
+long store_req, store_hit, store_add;
+
+
+/* STORE_MIX - Mix a word into a hash value. */
+
+static bit_type store_mix(bit_type h, bit_type x)
+{
+    h^= x + 0x9e3779b97f4a7c15UL + (h << 6) + (h >> 2);
+    h^= h >> 31;
+    h*= 0xbf58476d1ce4e5b9UL;
+    h^= h >> 29;
+    return h;
+}
+
+
+/* CLUE_KEY - Compute the two hashes identifying the clue for line i in
+ * direction k.  If rev is true, the clue is hashed in reverse order.  This is
+ * done before clue_init() has set clue->linelen, so we get the line length
+ * from the size of the grid.
+ */
+
+static void clue_key(Puzzle *puz, dir_t k, line_t i, int rev, bit_type *key)
+{
+    Clue *clue= &puz->clue[k][i];
+    bit_type h1= 0x243f6a8885a308d3UL, h2= 0x13198a2e03707344UL;
+    bit_type x;
+    line_t b, bb;
+
+    x= ((bit_type)puz->n[1-k] << 16) | (bit_type)puz->ncolor;
+    h1= store_mix(h1, x);
+    h2= store_mix(h2, ~x);
+    for (b= 0; b < clue->n; b++)
+    {
+	bb= rev ? clue->n - 1 - b : b;
+	x= ((bit_type)clue->length[bb] << 8) | (bit_type)clue->color[bb];
+	h1= store_mix(h1, x);
+	h2= store_mix(h2, ~x);
+    }
+    x= clue->n;
+    key[0]= store_mix(h1, x) | 1;	/* Never zero */
+    key[1]= store_mix(h2, x);
+}
+
+
+/* OPEN_STORE - Open or create the persistent line store in the named file.
+ * Returns 0 on success.  On failure, prints a warning and returns 1, and we
+ * just go on without it.
+ */
+
+int open_store(Puzzle *puz, char *filename)
+{
+    StoreHeader hdr;
+    struct stat st;
+    int fd, k;
+    line_t i;
+    long size;
+    void *map;
+
+    /* When solving several puzzles, the file is only opened for the first,
+     * but each one needs its own clue hashes */
+    if (store_slots != NULL) goto setkeys;
+
+    store_sw= STORE_STATEWORDS;
+
+    if ((fd= open(filename, O_RDWR|O_CREAT, 0666)) < 0)
+    {
+	fprintf(stderr,"Cannot open line store %s\n",filename);
+	return 1;
+    }
+    flock(fd, LOCK_EX);
+
+    if (fstat(fd, &st) || st.st_size == 0)
+    {
+	/* New file - write the header and size the table */
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, STORE_MAGIC, 8);
+	hdr.version= STORE_VERSION;
+	hdr.wordsize= sizeof(bit_type);
+	hdr.statewords= STORE_STATEWORDS;
+	hdr.nslots= STORE_SLOTS;
+	size= sizeof(hdr) +
+	    hdr.nslots * (3 + 2*hdr.statewords) * sizeof(bit_type);
+	if (ftruncate(fd, size) ||
+		pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+	{
+	    fprintf(stderr,"Cannot initialize line store %s\n",filename);
+	    goto bad;
+	}
+    }
+    else if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+	memcmp(hdr.magic, STORE_MAGIC, 8) || hdr.version != STORE_VERSION ||
+	hdr.wordsize != sizeof(bit_type) || hdr.statewords < 1 ||
+	hdr.nslots < STORE_PROBES ||
+	st.st_size < sizeof(hdr) +
+	    hdr.nslots * (3 + 2*hdr.statewords) * sizeof(bit_type))
+    {
+	fprintf(stderr,"%s is not a version %d line store\n",
+		filename, STORE_VERSION);
+	goto bad;
+    }
+    flock(fd, LOCK_UN);
+
+    store_sw= hdr.statewords;
+    store_ssize= 3 + 2*store_sw;
+    store_nslots= hdr.nslots;
+    size= sizeof(hdr) + store_nslots * store_ssize * sizeof(bit_type);
+
+    map= mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+	fprintf(stderr,"Cannot map line store %s\n",filename);
+	return 1;
+    }
+    store_slots= (bit_type *)((char *)map + sizeof(StoreHeader));
+    copy= (bit_type *)malloc(store_ssize * sizeof(bit_type));
+
+    if (VH) printf("H: Opened line store %s with %ld slots\n",
+	    filename, store_nslots);
+
+setkeys:
+    /* Work out the clue hashes for each line.  Lines that have negative clue
+     * ids are stored in the cache reversed, so reverse the clue too */
+    init_clue_ids(puz);
+    for (k= 0; k < 2; k++)
+    {
+	free(store_key[k]);
+	store_key[k]= (bit_type *)malloc(2 * puz->n[k] * sizeof(bit_type));
+	for (i= 0; i < puz->n[k]; i++)
+	    clue_key(puz, k, i, clue_id(k,i) < 0, store_key[k] + 2*i);
+    }
+    return 0;
+
+bad:
+    flock(fd, LOCK_UN);
+    close(fd);
+    return 1;
+}
+
+
+/* STORE_SLOT - Return the first slot that the given key could be in. */
+
+static bit_type *store_slot(bit_type *key, bit_type *state, int len)
+{
+    bit_type h= key[0];
+    int j;
+
+    for (j= 0; j < len; j++)
+	h= store_mix(h, state[j]);
+    return store_slots +
+	(h % (store_nslots - STORE_PROBES + 1)) * store_ssize;
+}
+
+
+/* STORE_MATCH - Does a slot (or a copy of one) hold the given key? */
+
+static int store_match(bit_type *s, bit_type *key, bit_type *state, int len)
+{
+    int j;
+
+    if (key1(s) != key[0] || key2(s) != key[1]) return 0;
+    for (j= 0; j < len; j++)
+	if (oldst(s)[j] != state[j]) return 0;
+    for (; j < store_sw; j++)
+	if (oldst(s)[j] != 0) return 0;
+    return 1;
+}
+
+
+/* FIND_STORE - Look up the compressed state of line i in direction k, which
+ * is len words long.  If it is found, return a pointer to the compressed
+ * solved state.  The calling program should not free it.  If it is not
+ * found, return NULL.
+ */
+
+bit_type *find_store(dir_t k, line_t i, bit_type *state, int len)
+{
+    bit_type *key= store_key[k] + 2*i;
+    bit_type *s;
+    bit_type seq;
+    int p;
+
+    if (len > store_sw) return NULL;
+    store_req++;
+
+    s= store_slot(key, state, len);
+    for (p= 0; p < STORE_PROBES; p++, s+= store_ssize)
+    {
+	seq= __atomic_load_n(seqword(s), __ATOMIC_ACQUIRE);
+	if (seq & 1) continue;		/* Being written */
+	memcpy(copy, s, store_ssize * sizeof(bit_type));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(seqword(s), __ATOMIC_RELAXED) != seq)
+	    continue;			/* Changed while we read it */
+
+	if (key1(copy) == 0) return NULL;
+	if (store_match(copy, key, state, len))
+	{
+	    store_hit++;
+	    return newst(copy);
+	}
+    }
+    return NULL;
+}
+
+
+/* ADD_STORE - Store the solved state of line i in direction k.  The states
+ * before and after solving are len words long.  If we can't get a slot
+ * without waiting, we just don't store it.
+ */
+
+void add_store(dir_t k, line_t i, bit_type *old, bit_type *new, int len)
+{
+    bit_type *key= store_key[k] + 2*i;
+    bit_type *s, *first, *victim= NULL;
+    bit_type seq;
+    int p;
+
+    if (len > store_sw) return;
+
+    /* Use a matching or empty slot if there is one, otherwise pick one of
+     * the slots to replace, based on the clue hash. */
+    first= store_slot(key, old, len);
+    for (p= 0, s= first; p < STORE_PROBES; p++, s+= store_ssize)
+	if (key1(s) == 0 || store_match(s, key, old, len))
+	{
+	    victim= s;
+	    break;
+	}
+    if (victim == NULL)
+	victim= first + (key[1] % STORE_PROBES) * store_ssize;
+
+    /* Lock the slot */
+    seq= __atomic_load_n(seqword(victim), __ATOMIC_RELAXED);
+    if ((seq & 1) || !__atomic_compare_exchange_n(seqword(victim), &seq,
+	    seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	return;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    key1(victim)= key[0];
+    key2(victim)= key[1];
+    memset(oldst(victim), 0, 2 * store_sw * sizeof(bit_type));
+    memcpy(oldst(victim), old, len * sizeof(bit_type));
+    memcpy(newst(victim), new, len * sizeof(bit_type));
+
+    /* Unlock it */
+    __atomic_store_n(seqword(victim), seq + 2, __ATOMIC_RELEASE);
+    store_add++;
+}
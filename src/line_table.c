@@ -0,0 +1,198 @@
+/* Copyright 2012 Jan Wolter
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* LINE TABLES - For two color puzzles, short lines are solved by looking up
+ * the answer in a table instead of running the line solver.
+ *
+ * Each cell of a two color line is in one of three states: it may be either
+ * color, it must be white, or it must be black.  So a line of n cells has
+ * 3^n possible states, and we can number them by treating the cell states as
+ * the digits of a base three number.  For each distinct clue (as identified
+ * by the clue ids assigned in line_cache.c) whose line is at most
+ * LINETABLE_MAX cells long, we keep an array with one entry for each of
+ * those states.  The arrays are allocated the first time the clue is looked
+ * up, and entries are filled in the first time that state is solved, by
+ * storing the state the line was left in after the line solver ran on it.
+ *
+ * Unlike the line cache, the tables are never flushed, and lookups take no
+ * hashing or comparison, so they are used from the start, not just once we
+ * start searching.  Clue ids are kept from one puzzle to the next when
+ * several puzzles are solved in one run, so the tables are too.
+ *
+ * Each entry is an unsigned int.  The high bit is set if the entry has been
+ * filled in.  Bits 2j and 2j+1 are set if cell j may be white or black in
+ * the solved line.  Cells are numbered in the direction of the table's clue,
+ * so lines with reversed clues are read and written in reverse order.
+ */
+
+#include "pbnsolve.h"
+
+#if LINETABLE_MAX > 15
+#error LINETABLE_MAX must be no more than 15
+#endif
+
+#define TABLE_DONE 0x80000000
+
+/* Pointers to the tables, indexed by clue id.  NULL if not yet allocated */
+static unsigned int **table= NULL;
+static int ntable= 0;
+static int tablegen= 0;	/* clid_generation the tables were made for */
+
+/* Entry found by the last call to line_table(), and the direction we read
+ * the line in.  Used by add_table() to store the result.
+ */
+static unsigned int *lastentry= NULL;
+static int lastrev;
+
+/* A storage place for an uncompressed solution */
+static bit_type *col;
+#define colbit(i) (col+(fbit_size*(i)))
+
+long table_req, table_hit, table_add, table_clues;
+
+
+/* INIT_TABLE: Set up the line tables for a puzzle.  This turns tablelines
+ * on if the puzzle is one we can handle.
+ */
+
+void init_table(Puzzle *puz)
+{
+    line_t maxdimension;
+    int n, id;
+
+    tablelines= 0;
+    if (puz->type != PT_GRID || puz->ncolor > 2)
+	return;
+
+    /* Don't bother if no lines are short enough */
+    if (puz->n[D_ROW] > LINETABLE_MAX && puz->n[D_COL] > LINETABLE_MAX)
+	return;
+
+    /* Keep the tables from earlier puzzles, unless the clue ids have been
+     * given out again from the start */
+    n= init_clue_ids(puz);
+    if (tablegen != clid_generation)
+    {
+	for (id= 0; id < ntable; id++)
+	    free(table[id]);
+	ntable= 0;
+	tablegen= clid_generation;
+    }
+    if (n > ntable)
+    {
+	table= (unsigned int **)realloc(table, n * sizeof(unsigned int *));
+	memset(table + ntable, 0, (n - ntable) * sizeof(unsigned int *));
+	ntable= n;
+    }
+
+    maxdimension= (puz->n[D_ROW] > puz->n[D_COL]) ?
+	puz->n[D_ROW] : puz->n[D_COL];
+    free(col);
+    col= (bit_type *)malloc(maxdimension * fbit_size * sizeof(bit_type));
+
+    tablelines= 1;
+}
+
+
+/* LINE_TABLE: Look up the solution to line i in direction k in the line
+ * tables.  If it is there, return it as an array of bitstrings, in the same
+ * format as lro_solve() returns.  The calling program should NOT free this
+ * array.  If it is not there, return NULL, and remember where it should go
+ * so that add_table() can store it after it has been computed.  The line
+ * must be no longer than LINETABLE_MAX.
+ */
+
+bit_type *line_table(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    line_t ncell= puz->clue[k][i].linelen;
+    Cell **cell= sol->line[k][i];
+    int id= clue_id(k, i);
+    unsigned int index, entry, size;
+    line_t j;
+
+    table_req++;
+
+    if ((lastrev= (id < 0))) id= -id;
+
+    if (table[id] == NULL)
+    {
+	for (size= 1, j= 0; j < ncell; j++)
+	    size*= 3;
+	table[id]= (unsigned int *)calloc(size, sizeof(unsigned int));
+	table_clues++;
+	if (VH) printf("H: Allocated line table for clue id %d (%d entries)\n",
+		id, size);
+    }
+
+    /* Compute the base three index of the current line state */
+    index= 0;
+    for (j= 0; j < ncell; j++)
+    {
+	Cell *c= cell[lastrev ? ncell - 1 - j : j];
+	index*= 3;
+	if (!may_be(c, 0))
+	    index+= 2;
+	else if (!may_be(c, 1))
+	    index+= 1;
+    }
+
+    lastentry= table[id] + index;
+    entry= *lastentry;
+    if (!(entry & TABLE_DONE))
+	return NULL;
+
+    table_hit++;
+    lastentry= NULL;
+
+    for (j= 0; j < ncell; j++)
+    {
+	unsigned int v= entry >> (2 * (lastrev ? ncell - 1 - j : j));
+	bit_type *cb= colbit(j);
+	fbit_clearall(cb);
+	if (v & 1) bit_set(cb, 0);
+	if (v & 2) bit_set(cb, 1);
+    }
+
+    if (VH && VV)
+	printf("H: Line table hit on %s %d\n", CLUENAME(puz->type,k), i);
+
+    return col;
+}
+
+
+/* ADD_TABLE: Store the current state of line i in direction k into the table
+ * entry found by the last call to line_table().  This should be called after
+ * line solving on the line failed to find it in the table.
+ */
+
+void add_table(Puzzle *puz, Solution *sol, dir_t k, line_t i)
+{
+    line_t ncell= puz->clue[k][i].linelen;
+    Cell **cell= sol->line[k][i];
+    unsigned int entry= TABLE_DONE;
+    line_t j;
+
+    if (lastentry == NULL) return;
+
+    for (j= 0; j < ncell; j++)
+    {
+	Cell *c= cell[lastrev ? ncell - 1 - j : j];
+	if (may_be(c, 0)) entry|= 1 << (2*j);
+	if (may_be(c, 1)) entry|= 2 << (2*j);
+    }
+    *lastentry= entry;
+    lastentry= NULL;
+    table_add++;
+}
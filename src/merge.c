@@ -23,11 +23,17 @@ MergeElem *mergegrid;	/* Grid of merge cells */
 extern bit_type *oldval;
 
 
-/* INIT_MERGE - Allocate merge array */
+/* INIT_MERGE - Allocate merge array.  This is called before the solution is
+ * made, so puz->ncells may not be set yet. */
 
 void init_merge(Puzzle *puz)
 {
-    mergegrid= (MergeElem *)calloc(puz->ncells, sizeof(MergeElem));
+    free(mergegrid);
+    mergegrid= (MergeElem *)calloc(puz->n[D_ROW] * puz->n[D_COL],
+	    MERGESIZE);
+    merge_list= NULL;
+    merge_no= -1;
+    merging= 0;
 }
 
 
@@ -118,7 +124,7 @@ void merge_set(Puzzle *puz, Cell *cell, bit_type *bit)
     int zero;
 
     /* Get the merge element for this cell */
-    m= &mergegrid[cell->id];
+    m= MERGE(cell->id);
     
     if (m->cell == NULL)
     {
@@ -129,12 +135,11 @@ void merge_set(Puzzle *puz, Cell *cell, bit_type *bit)
 	/* Otherwise, make a new merge list entry */
 	m->cell= cell;
 	m->maxc= merge_no;
-#ifdef LIMITCOLORS
-	m->bit[0]= cell->bit[0] & ~bit[0];
-#else
-	for (z= 0; z < fbit_size; z++)
-	    m->bit[z]= cell->bit[z] & ~bit[z];
-#endif
+	if (fbit_size == 1)
+	    m->bit[0]= cell->bit[0] & ~bit[0];
+	else
+	    for (z= 0; z < fbit_size; z++)
+		m->bit[z]= cell->bit[z] & ~bit[z];
 	m->next= merge_list;
 	merge_list= m;
 	if (VM)
@@ -158,7 +163,8 @@ void merge_set(Puzzle *puz, Cell *cell, bit_type *bit)
 	if (merge_no == 0)
 	    /* If this is pass zero, the we can OR the changes in because
 	     * we haven't ANDed it with anything else yet */
-	    m->bit[0]|= cell->bit[0] & ~bit[0];
+	    for (z= 0; z < fbit_size; z++)
+		m->bit[z]|= cell->bit[z] & ~bit[z];
 
 	if (VM)
 	{
@@ -172,19 +178,18 @@ void merge_set(Puzzle *puz, Cell *cell, bit_type *bit)
     }
 
     /* If the cell is on the list from previous probe, intersect the changes */
-#ifdef LIMITCOLORS
-    m->bit[0]&= cell->bit[0] & ~bit[0];
-    if (m->bit[0] == 0)
-#else
-    zero= 1;
-    for (z= 0; z < fbit_size; z++)
+    if (fbit_size == 1)
+	zero= ((m->bit[0]&= cell->bit[0] & ~bit[0]) == 0);
+    else
     {
-    	m->bit[z]&= cell->bit[z] & ~bit[z];
-	if (m->bit[z]) zero= 0;
-
+	zero= 1;
+	for (z= 0; z < fbit_size; z++)
+	{
+	    m->bit[z]&= cell->bit[z] & ~bit[z];
+	    if (m->bit[z]) zero= 0;
+	}
     }
     if (zero)
-#endif
     {
     	/* No intersection - mark the node for deletion. Actual
 	 * deletion from linked list happens during merge_guess. */
@@ -239,16 +244,19 @@ int merge_check(Puzzle *puz, Solution *sol)
 	    add_hist(puz, m->cell, 0);
 
 	    /* Set the new value in the cell */
-#ifdef LIMITCOLORS
-	    oldval[0]= m->cell->bit[0];
-	    m->cell->bit[0]&= ~m->bit[0];
-#else
-	    for (z= 0; z < fbit_size; z++)
+	    if (fbit_size == 1)
 	    {
-		oldval[z]= m->cell->bit[z];
-	        m->cell->bit[z]&= ~m->bit[z];
+		oldval[0]= m->cell->bit[0];
+		m->cell->bit[0]&= ~m->bit[0];
 	    }
-#endif
+	    else
+		for (z= 0; z < fbit_size; z++)
+		{
+		    oldval[z]= m->cell->bit[z];
+		    m->cell->bit[z]&= ~m->bit[z];
+		}
+	    cell_changed(puz, m->cell, oldval);
+
 	    if (puz->ncolor <= 2)
 	        m->cell->n= 1;
 	    else
@@ -28,16 +28,23 @@ char *version= "1.10";
 int verb[NVERB];
 int maybacktrack= 1, mayexhaust= 1, maycontradict= 0, maycache= 1;
 int mayguess= 1, mayprobe= 1, mergeprobe= 0, maylinesolve= 1;
+int maysettle= 0, maytable= 1, maysegment= 0, maybitwise= 0;
 int contradepth= 2;
 int hintlog= 0, hintlogn= -1;
 int checkunique= 0;
 int checksolution= 0;
-int cachelines= 0;
+int recordlines= 0;
+int cachelines= 0, tablelines= 0;
+int cachemb= 0;
+int storelines= 0;
 int http= 0, terse= 0;
 int catch_intr= 0;
+int puzzleno= 0;	/* Number of the current puzzle, counting from zero */
 
 long nlines, probes, guesses, backtracks, merges, nsprint, nplod;
 long exh_runs, exh_cells;
+long settle_runs, settle_cells;
+long prepass_runs, prepass_skips;
 long contratests, contrafound;
 
 clock_t sclock;
@@ -121,6 +128,25 @@ int setalg(char ch)
 	/* Caching of linesolver results */
 	maycache= 1;
     	break;
+    case 'T':
+	/* Table lookup of short line solutions */
+	maytable= 1;
+    	break;
+    case 'D':
+	/* Divide lines into segments for caching - requires caching */
+	maycache= 1;
+	maysegment= 1;
+    	break;
+    case 'B':
+	/* Bit-parallel LRO line solver for two color lines */
+	maylinesolve= 1;
+	maybitwise= 1;
+    	break;
+    case 'S':
+	/* Settle line solver - requires LRO line solving */
+	maylinesolve= 1;
+	maysettle= 1;
+    	break;
     case 0:
 	/* Called to turn everything off */
 	maylinesolve= 0;
@@ -130,6 +156,10 @@ int setalg(char ch)
 	mergeprobe= 0;
 	maycontradict= 0;
 	maycache= 0;
+	maysettle= 0;
+	maytable= 0;
+	maysegment= 0;
+	maybitwise= 0;
     	break;
     default:
     	return 0;
@@ -138,6 +168,9 @@ int setalg(char ch)
 }
 
 
+/* Number of puzzle files given on the command line */
+static int nfile= 0;
+
 /* PRINT_STATS - print out various runtime statistics */
 void print_stats(FILE *fp, Puzzle *puz, clock_t eclock)
 {
@@ -147,13 +180,24 @@ void print_stats(FILE *fp, Puzzle *puz, clock_t eclock)
     fprintf(fp,"Cells Solved: %d of %d\n",puz->nsolved, puz->ncells);
     fprintf(fp,"Lines in Puzzle: %d\n",totallines);
     fprintf(fp,"Lines Processed: %ld (%ld%%)\n",nlines,nlines/totallines*100);
+    if (prepass_runs > 0)
+	fprintf(fp,"Pre-pass: %ld of %ld lines skipped (%.1f%%)\n",
+	    prepass_skips, prepass_runs,
+	    (float)prepass_skips*100/prepass_runs);
     if (exh_runs > 0 || mayexhaust)
 	fprintf(fp,"Exhaustive Search: %ld cell%s in %ld pass%s\n",
 	    exh_cells, (exh_cells == 1) ?"":"s",
 	    exh_runs, (exh_runs == 1) ?"":"es");
+    if (maysettle)
+	fprintf(fp,"Settle Solver: %ld cell%s in %ld line%s\n",
+	    settle_cells, (settle_cells == 1) ?"":"s",
+	    settle_runs, (settle_runs == 1) ?"":"s");
     if (maycontradict)
 	fprintf(fp,"Contradiction Testing: %ld tests, %ld found\n",
 	    contratests, contrafound);
+    if (feas_runs > 0)
+	fprintf(fp,"Feasibility Checks: %ld lines, %ld infeasible, "
+		"%ld cached\n", feas_runs, feas_fails, feas_hit);
     if (!mayprobe)
 	fprintf(fp,"Backtracking: %ld guesses, %ld backtracks\n",
 	    guesses,backtracks);
@@ -168,10 +212,29 @@ void print_stats(FILE *fp, Puzzle *puz, clock_t eclock)
     if (mayprobe && mayguess)
 	fprintf(fp,"Plod cycles: %ld, Sprint cycles: %ld\n", nplod, nsprint);
     if (maycache)
-	fprintf(fp,"Cache Hits: %ld/%ld (%.1f%%) Adds: %ld  Flushes: %ld\n",
+	fprintf(fp,"Cache Hits: %ld/%ld (%.1f%%) Adds: %ld  Evictions: %ld  "
+		"Rebuilds: %ld  Size: %ldK  Bypasses: %ld\n",
 		cache_hit, cache_req,
 		(float)(cache_req ? cache_hit*100/cache_req : 0),
-		cache_add, cache_flush);
+		cache_add, cache_evict, cache_rehash, cache_bytes/1024,
+		cache_bypass);
+    if (maycache && cache_seglines > 0)
+	fprintf(fp,"Cache Segments: %ld lines split into %ld segments\n",
+		cache_seglines, cache_segs);
+    if (maycache && nfile > 1)
+	fprintf(fp,"Cache Hits From Earlier Puzzles: %ld (%.1f%%)\n",
+		cache_xhit,
+		(float)(cache_hit ? cache_xhit*100/cache_hit : 0));
+    if (storelines)
+	fprintf(fp,"Store Hits: %ld/%ld (%.1f%%) Adds: %ld\n",
+		store_hit, store_req,
+		(float)(store_req ? store_hit*100/store_req : 0),
+		store_add);
+    if (tablelines)
+	fprintf(fp,"Table Hits: %ld/%ld (%.1f%%) Adds: %ld  Clues: %ld\n",
+		table_hit, table_req,
+		(float)(table_req ? table_hit*100/table_req : 0),
+		table_add, table_clues);
     fprintf(fp,"Processing Time: %f sec \n",
 	    (float)(eclock - sclock)/CLOCKS_PER_SEC);
 }
@@ -195,21 +258,26 @@ void intr(int sig)
 #define SN_CPU 3
 #define SN_CDEPTH 4
 #define SN_HINTLOG 5
+#define SN_CACHEMB 6
 
 int main(int argc, char **argv)
 {
-    char *filename= NULL;
+    char *filename= NULL, **filenames;
     Puzzle *puz;
     SolutionList *sl= NULL;
     Solution *sol= NULL;
     int setnumber= SN_NONE;
     char *format= NULL, *vi, *vchar= VCHAR;
+    char *storefile= NULL;
     char *altsoln= NULL, *goal= NULL;
     int pindex= 1;	/* if input file has multiple puzzles, which to do */
     int cpulimit= DEFAULT_CPULIMIT;
     int i,j, vflag= 0, aflag= 0;
     int startsol= 0;	/* solution to start from, 0 means none */
-    int setformat= 0, dump= 0, statistics= 0;
+    int ifile= 0;	/* index in filenames of the current puzzle */
+    int exhaustopt, hintlogopt;
+    extern int bookkeeping;
+    int setformat= 0, setstore= 0, dump= 0, statistics= 0;
     int fmt, isunique, iscomplete;
     int totallines, rc;
     clock_t eclock;
@@ -286,6 +354,7 @@ int main(int argc, char **argv)
     }
     else
     {
+	filenames= (char **)malloc(argc * sizeof(char *));
 	for (i= 1; i < argc; i++)
 	{
 	    if (argv[i][0] == '-')
@@ -327,6 +396,10 @@ int main(int argc, char **argv)
 			    contradepth= 10*contradepth + argv[i][j] - '0';
 			    continue;
 
+			case SN_CACHEMB:
+			    cachemb= 10*cachemb + argv[i][j] - '0';
+			    continue;
+
 			case SN_HINTLOG:
 			    if (hintlogn < 0) hintlogn= 0;
 			    hintlogn= 10*hintlogn + argv[i][j] - '0';
@@ -368,6 +441,10 @@ int main(int argc, char **argv)
 			setnumber= SN_CDEPTH;
 			contradepth= 0;
 			break;
+		    case 'k':
+			setnumber= SN_CACHEMB;
+			cachemb= 0;
+			break;
 		    case 's':
 			setnumber= SN_START;
 			startsol= 0;
@@ -383,6 +460,9 @@ int main(int argc, char **argv)
 		    case 'i':
 			catch_intr= 1;
 			break;
+		    case 'r':
+			recordlines= 1;
+			break;
 		    case 'm':
 			hintlog= 1;
 			setnumber= SN_HINTLOG;
@@ -398,6 +478,14 @@ int main(int argc, char **argv)
 			}
 			setformat= 1;
 			break;
+		    case 'p':
+		    	if (argv[i][j+1] != '\0')
+			{
+			    storefile= &(argv[i][j+1]);
+			    goto optdone;
+			}
+			setstore= 1;
+			break;
 #ifdef LINEWATCH
 		    case 'w':
 			if (nwatch >= MAXWATCH) goto usage;
@@ -426,9 +514,15 @@ int main(int argc, char **argv)
 		     (setnumber == SN_INDEX && pindex > 0) ||
 		     (setnumber == SN_CPU && cpulimit > 0) ||
 		     (setnumber == SN_CDEPTH && contradepth > 0) ||
+		     (setnumber == SN_CACHEMB && cachemb > 0) ||
 		     (setnumber == SN_HINTLOG && hintlogn > 0) )
 			setnumber= SN_NONE;
 	    }
+	    else if (setstore)
+	    {
+	    	storefile= argv[i];
+		setstore= 0;
+	    }
 	    else if (setformat)
 	    {
 	    	format= argv[i];
@@ -441,14 +535,14 @@ int main(int argc, char **argv)
 		else if (setnumber == SN_INDEX) pindex= n;
 		else if (setnumber == SN_CPU) cpulimit= n;
 		else if (setnumber == SN_CDEPTH) contradepth= n;
+		else if (setnumber == SN_CACHEMB) cachemb= n;
 		else if (setnumber == SN_HINTLOG) hintlog= n;
 		setnumber= SN_NONE;
 	    }
-	    else if (filename == NULL)
-		filename= argv[i];
 	    else
-		goto usage;
+		filenames[nfile++]= argv[i];
 	}
+	if (nfile > 0) filename= filenames[0];
 	if (pindex < 1) pindex= 1;
 	if (hintlogn < 0) hintlogn= 10;
 
@@ -462,6 +556,7 @@ int main(int argc, char **argv)
 		fail("Need -aL or -aE to be able to solve puzzles.\n");
 
 	if (setformat && !format) goto usage;
+	if (setstore) goto usage;
 	if (format)
 	{   
 	    fmt= fmt_code(format);
@@ -481,6 +576,26 @@ int main(int argc, char **argv)
 	    puz= load_puzzle_file(filename, fmt, pindex);
     }
 
+    /* When several puzzle files are given, we come back here for each one */
+nextpuzzle:
+    sl= NULL;
+    sol= NULL;
+    goal= altsoln= NULL;
+    cachelines= 0;
+    bookkeeping= 0;
+
+    /* The solver turns some options off as it goes, so put them back */
+    if (puzzleno == 0)
+    {
+	exhaustopt= mayexhaust;
+	hintlogopt= hintlog;
+    }
+    else
+    {
+	mayexhaust= exhaustopt;
+	hintlog= hintlogopt;
+    }
+
     if (catch_intr)
     {
 	ipuz= puz;
@@ -506,11 +621,37 @@ int main(int argc, char **argv)
 
     /* preallocate some arrays */
     init_line(puz);
+    init_bitboard(puz);
+    if (maysettle) init_settle(puz);
+    if (maytable) init_table(puz);
+    if (maycontradict || mayexhaust) init_check(puz);
+    if (maycache && (maycontradict || mayexhaust)) init_feas(puz);
     if (mergeprobe) init_merge(puz);
 
+    /* If we have a persistent line store, or are solving several puzzles,
+     * start caching right away, so we can use what was learned before from
+     * the start */
+    if (storefile != NULL && maycache && puz->type == PT_GRID)
+    {
+	if (open_store(puz, storefile))
+	    storefile= NULL;
+	else
+	    storelines= 1;
+    }
+    if ((storelines || nfile > 1) && maycache && puz->type == PT_GRID)
+    {
+	cachelines= 1;
+	init_cache(puz);
+    }
+
     if (VA) printf("A: pbnsolve version %s\n", version);
 
-    /* Print the name of the puzzle */
+    /* Print the name of the puzzle, and of the file if there are several */
+    if (!http && nfile > 1)
+    {
+	printf("%s: ", filename);
+	if (!terse && puz->id == NULL && puz->title == NULL) putchar('\n');
+    }
     if (!http && (puz->id != NULL || puz->title != NULL))
     {
 	if (puz->id != NULL) printf("%s: ", puz->id);
@@ -550,6 +691,7 @@ int main(int argc, char **argv)
     if (statistics) sclock= clock();
     make_goal_array(puz);
     clue_init(puz, sol);
+    if (bitboard) load_bitboard(puz, sol);
     init_jobs(puz, sol);
     if (VJ)
     {
@@ -557,7 +699,15 @@ int main(int argc, char **argv)
 	dump_jobs(stdout,puz);
     }
     nlines= probes= guesses= backtracks= merges= exh_runs= exh_cells= 0;
+    settle_runs= settle_cells= 0;
+    prepass_runs= prepass_skips= 0;
     contratests= contrafound= nsprint= 0;
+    feas_runs= feas_fails= feas_hit= 0;
+    cache_req= cache_hit= cache_xhit= cache_add= cache_evict= cache_rehash= 0;
+    cache_bypass= cache_seglines= cache_segs= 0;
+    store_req= store_hit= store_add= 0;
+    table_req= table_hit= table_add= table_clues= 0;
+    reset_probe_stats();
     nplod= 1;
     while (1)
     {
@@ -741,13 +891,29 @@ int main(int argc, char **argv)
 
     if (sl != NULL && sl->note) printf("%s\n",sl->note);
 
-    if (sl == NULL) free_solution(sol);
+    if (VH) dump_cache_stats(stdout, puz);
+
+    /* sl is left on the goal by -c, so check we didn't start from it */
+    if (sl == NULL || sol != &sl->s) free_solution(sol);
+    safefree(goal);
+    if (altsoln != puz->found) safefree(altsoln);
+    release_cache();
     free_puzzle(puz);
 
+    /* Go on to the next puzzle file, if there is one.  The line cache
+     * is kept, so it can be used on the new puzzle */
+    if (++ifile < nfile)
+    {
+	puzzleno++;
+	filename= filenames[ifile];
+	puz= load_puzzle_file(filename, fmt, pindex);
+	goto nextpuzzle;
+    }
+
     exit(0);
 
 usage:
-    fprintf(stderr,"usage: %s [-cdehu] [-s#] [-n#] [-x#] [=m#] [-aLEHGPM] [-vABEGJLMPUSV] [<filename>]\n",
+    fprintf(stderr,"usage: %s [-cdehru] [-s#] [-n#] [-x#] [-k#] [-p<file>] [=m#] [-aLEHTBGPMS] [-vABEGJLMPUSV] [<filename>...]\n",
     	argv[0]);
     exit(1);
 }
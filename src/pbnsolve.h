@@ -24,13 +24,17 @@
 #include "bitstring.h"
 
 /* Types */
+#ifdef BIGLINES
+typedef int line_t;	/* a row/column number - must be signed */
+#define MAXLINE INT_MAX   /* Max value that can be stored in line_t */
+#else
 typedef short line_t;	/* a row/column number - must be signed */
+#define MAXLINE SHRT_MAX  /* Max value that can be stored in line_t */
+#endif
 typedef char color_t;   /* a color number, an index into a color bit string */
 typedef char dir_t;     /* A direction */
 typedef char byte;	/* various small numbers */
 
-#define MAXLINE SHRT_MAX  /* Max value that can be stored in line_t */
-
 /* Puzzle solution - Representing a partial solution of a puzzle.
  *
  *  For each cell in the puzzle, we have a Cell structure  This contains
@@ -55,12 +59,19 @@ typedef char byte;	/* various small numbers */
  *  This somewhat redundant array structure is meant to generalize to things
  *  like triddlers more easily, and simplify a lot of the solver coding by
  *  making rows and columns work exactly alike.
+ *
+ *  The cells themselves are all kept in one block, sol->cells, in row-major
+ *  order, so that sol->line[D_ROW][i][j] is cell number i*sol->n[D_COL]+j,
+ *  which is also its id.  Cells may be longer than sizeof(Cell), so they are
+ *  sol->cellsize bytes apart.  A line can also be reached without the pointer
+ *  arrays, as the sol->n[1-k] cells starting at line_base(sol,k,i), each
+ *  line_stride(sol,k) bytes after the one before.
  */
 
 typedef struct {
     line_t line[3];	/* 2 or 3 line numbers of this cell */
     line_t index[3];	/* 2 or 3 indexes of this cell in those lines */
-    line_t id;		/* A unique number in (0,rows*cols-1) for this cell */
+    int id;		/* A unique number in (0,rows*cols-1) for this cell */
     color_t n;		/* Number of bits set in the bit string */
     bit_decl(bit,1);	/* bit string with 1 for each possible color */
 
@@ -87,8 +98,21 @@ typedef struct {
     Cell ***line[3];	/* 2 or 3 roots for the cell array */
     line_t n[3];	/* Length of the line[] arrays */
     Cell **spiral;	/* An array pointing to all cells in spiral pattern */
+    Cell *cells;	/* All the cells, in row-major order */
+    size_t cellsize;	/* Bytes from one cell to the next in cells */
 } Solution;
 
+/* Macros to find cells in the cell block of a grid puzzle */
+#define cell_num(sol,n) \
+	((Cell *)((char *)(sol)->cells + (size_t)(n) * (sol)->cellsize))
+#define grid_cell(sol,i,j) cell_num(sol, (long)(i) * (sol)->n[D_COL] + (j))
+#define line_base(sol,k,i) \
+	((k) == D_ROW ? grid_cell(sol,i,0) : grid_cell(sol,0,i))
+#define line_stride(sol,k) \
+	((k) == D_ROW ? (sol)->cellsize : (sol)->cellsize * (sol)->n[D_COL])
+#define line_cell(sol,k,i,j) \
+	((Cell *)((char *)line_base(sol,k,i) + (size_t)(j) * line_stride(sol,k)))
+
 
 /* Solution List - A list of solutions, loaded from the XML file */
 
@@ -128,6 +152,11 @@ typedef struct {
     line_t lbadb,rbadb;	/* Bad interval index in lpos,rpos. LINEMAX if none */
     line_t lbadi,rbadi;	/* Cell index spoiling lpos,rcov.  LINEMAX if none  */
     int lstamp,rstamp;	/* nhist value at time that lpos,rpos were computed */
+    int trail;		/* trail_top when last pushed on the trail */
+    byte lstale,rstale;	/* lpos,rpos put back by an undo that discarded them */
+    byte fsm;		/* Line solver variant to use, set by init_line() */
+    bit_type *nfa;	/* Automaton for line_feasible(), set by init_check() */
+    int nfastate;		/* Number of states in the automaton */
 #ifdef LINEWATCH
     byte watch;		/* True if we are watching this line */
 #endif
@@ -166,7 +195,7 @@ typedef struct hist_list {
 } Hist;
 
 /* Size of a history element */
-#define HISTSIZE(puz) (sizeof(Hist) + fbit_size - bit_size(1))
+#define HISTSIZE(puz) (sizeof(Hist) + (fbit_size - bit_size(1))*sizeof(bit_type))
 
 /* i-th element of the history array */
 #define HIST(puz,i) ((Hist *)(((char *)puz->history)+(i)*HISTSIZE(puz)))
@@ -186,6 +215,10 @@ typedef struct merge_elem {
      */
 } MergeElem;
 
+/* Size of a merge element, and the merge element for the i-th cell */
+#define MERGESIZE (sizeof(MergeElem) + (fbit_size - bit_size(1))*sizeof(bit_type))
+#define MERGE(i) ((MergeElem *)(((char *)mergegrid)+(i)*MERGESIZE))
+
 
 /* Puzzle definition - Describes a puzzle (not it's solution).
  *
@@ -222,6 +255,7 @@ typedef struct {
     color_t ncolor,scolor; /* Number of colors used, size of color array */
     Clue *clue[3];	/* Arrays of clues (nset of which are used) */
     line_t n[3];	/* Length of the clue[] arrays */
+    line_t *clueblock;	/* Block holding all the clues' arrays, once packed */
     ColorDef *color;	/* Array of color definitions */
     char *source;
     char *id;
@@ -339,7 +373,14 @@ extern int mayexhaust;
 extern int maycontradict;
 extern int contradepth;
 extern int hintlog;
-extern int maycache, cachelines;
+extern int maycache, cachelines, cachemb;
+extern int storelines;
+extern int maysettle;
+extern int maytable, tablelines;
+extern int maysegment;
+extern int maybitwise;
+extern int recordlines;
+extern int puzzleno;
 extern long nsprint, nplod;
 
 /* pbnsolve.c functions */
@@ -379,7 +420,6 @@ void dump_jobs(FILE *fp, Puzzle *puz);
 void dump_history(FILE *fp, Puzzle *puz, int full);
 
 /* grid.c functions */
-Cell *new_cell(color_t ncolor);
 Solution *new_solution(Puzzle *puz);
 int count_solved(Solution *sol);
 void init_solution(Puzzle *puz, Solution *sol, int set);
@@ -397,14 +437,25 @@ void init_line(Puzzle *puz);
 void dump_lro_solve(Puzzle *puz, dir_t k, line_t i, bit_type *col);
 int left_check(Clue *clue, line_t i, bit_type *bit);
 int right_check(Clue *clue, line_t i, bit_type *bit);
-void left_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new);
-void right_undo(Puzzle *puz, Clue *clue, Cell **line, line_t i, bit_type *new);
+extern int trail_top;
+void init_trail(void);
+void trail_branch(Puzzle *puz);
+void trail_save(Clue *clue);
+void trail_undo(Puzzle *puz);
+#define trail_clue(clue) {if ((clue)->trail != trail_top) trail_save(clue);}
 int left_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	        line_t **ppos, line_t **pbcl);
 int right_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
 	        line_t **ppos, line_t **pbcl);
+int use_bw(Clue *clue);
+void bw_load(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+int left_solve_bw(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
+	        line_t **ppos, line_t **pbcl);
+int right_solve_bw(Puzzle *puz, Solution *sol, dir_t k, line_t i, int savepos,
+	        line_t **ppos, line_t **pbcl);
 bit_type *lro_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i);
 int apply_lro(Puzzle *puz, Solution *sol, dir_t k, line_t i, int depth);
+extern long prepass_runs, prepass_skips;
 
 /* job.c functions */
 void flush_jobs(Puzzle *puz);
@@ -442,6 +493,7 @@ extern bit_type *probepad;
 void probe_init(Puzzle *puz, Solution *sol);
 int probe(Puzzle *puz, Solution *sol, line_t *besti, line_t *bestj, color_t *bestc);
 void probe_stats(void);
+void reset_probe_stats(void);
 float probe_rate(void);
 int set_probing(int n);
 
@@ -457,6 +509,7 @@ char *get_query(void);
 char *query_lookup(char *query, char *var);
 
 /* clue.c functions */
+void pack_clues(Puzzle *puz);
 void clue_init(Puzzle *puz, Solution *sol);
 void make_clues(Puzzle *puz, Solution *sol);
 
@@ -467,8 +520,65 @@ void merge_guess(void);
 void merge_set(Puzzle *puz, Cell *cell, bit_type *bit);
 int merge_check(Puzzle *puz, Solution *sol);
 
+/* line_settle.c functions */
+extern long settle_runs, settle_cells;
+void init_settle(Puzzle *puz);
+bit_type *settle_solve(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+
+/* line_table.c functions */
+extern long table_req, table_hit, table_add, table_clues;
+void init_table(Puzzle *puz);
+bit_type *line_table(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+void add_table(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+
+/* line_check.c functions */
+extern long feas_runs, feas_fails;
+void init_check(Puzzle *puz);
+int line_feasible(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	line_t **ppos, line_t **pbcl);
+
+/* bitboard.c functions */
+extern int bitboard;
+extern Solution *bb_sol;
+extern bit_type *bb_mask[2][2];
+extern int bb_nword[2];
+#define bb_white(k,i) (bb_mask[0][k] + (i)*bb_nword[k])
+#define bb_black(k,i) (bb_mask[1][k] + (i)*bb_nword[k])
+#define bb_valid(sol) (bitboard && bb_sol == (sol))
+void init_bitboard(Puzzle *puz);
+void load_bitboard(Puzzle *puz, Solution *sol);
+void bb_changed(Cell *cell, bit_type *bit);
+line_t bb_next_unsolved(Solution *sol, line_t i, line_t j);
+int bb_count_solved(Solution *sol);
+int bb_all_unknown(dir_t k, line_t i, line_t lo, line_t hi);
+
 /* line_cache.c function */
 void init_cache(Puzzle *puz);
+int init_clue_ids(Puzzle *puz);
+extern int clid_generation;
+line_t clue_id(dir_t k, line_t i);
 bit_type *line_cache(Puzzle *puz,Solution *sol,dir_t k,line_t i);
 void add_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i);
-extern long cache_hit, cache_req, cache_add, cache_flush;
+int bypass_cache(dir_t k, line_t i);
+int split_line(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+bit_type *segment_cache(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+void add_segments(Puzzle *puz, Solution *sol, dir_t k, line_t i);
+void dump_cache_stats(FILE *fp, Puzzle *puz);
+void cell_changed(Puzzle *puz, Cell *cell, bit_type *bit);
+void repack_lines(void);
+void release_cache(void);
+void init_feas(Puzzle *puz);
+int find_feas(Puzzle *puz, Solution *sol, dir_t k, line_t i,
+	line_t **ppos, line_t **pbcl);
+void add_feas(Puzzle *puz, dir_t k, line_t i, int ok, line_t *pos,
+	line_t *bcl);
+extern long feas_hit;
+extern long cache_hit, cache_req, cache_add, cache_evict, cache_rehash;
+extern long cache_xhit, cache_bypass, cache_seglines, cache_segs;
+extern long cache_bytes;
+
+/* line_store.c functions */
+extern long store_req, store_hit, store_add;
+int open_store(Puzzle *puz, char *filename);
+bit_type *find_store(dir_t k, line_t i, bit_type *state, int len);
+void add_store(dir_t k, line_t i, bit_type *old, bit_type *new, int len);
@@ -55,16 +55,22 @@ static long probeseq_res[N_PRBRES][N_PRBSRC]= {{0,0,0},{0,0,0},{0,0,0}};
  */
 
 bit_type *probepad= NULL;
+static size_t probepadsize= 0;	/* Words allocated for probepad */
 int probing= 0;
 
 /* Create or clear the probe pad */
 void init_probepad(Puzzle *puz)
 {
-    if (!probepad)
-	probepad= (bit_type *)
-	    calloc(puz->ncells, fbit_size * sizeof(bit_type));
+    size_t size= (size_t)puz->ncells * fbit_size;
+
+    if (size > probepadsize)
+    {
+	free(probepad);
+	probepad= (bit_type *)calloc(size, sizeof(bit_type));
+	probepadsize= size;
+    }
     else
-    	memset(probepad, 0, puz->ncells * fbit_size * sizeof(bit_type));
+    	memset(probepad, 0, size * sizeof(bit_type));
 }
 
 
@@ -350,8 +356,14 @@ int probe(Puzzle *puz, Solution *sol,
 	{
 	    for (j= 0; (cell= sol->line[D_ROW][i][j]) != NULL; j++)
 	    {
-		/* Skip solved cells */
-		if (cell->n < 2) continue;
+		/* Skip solved cells.  On a two color grid, skip to the next
+		 * unsolved cell on the bitboard. */
+		if (bb_valid(sol))
+		{
+		    if ((j= bb_next_unsolved(sol, i, j)) < 0) break;
+		    cell= sol->line[D_ROW][i][j];
+		}
+		else if (cell->n < 2) continue;
 
 		/* Skip cells with less than two solved neighbors */
 		if (!probeon[PRBSRC_TWONEIGH] || count_neighbors(sol, i, j) < 2)
@@ -458,6 +470,28 @@ void probe_stats(void)
 }
 
 
+/* Probe counts as of the last call to probe_rate() */
+static long lastn= 0;
+static long lastnprobe= 0;
+
+/* RESET_PROBE_STATS - Zero the probing statistics, before starting on a new
+ * puzzle.
+ */
+void reset_probe_stats(void)
+{
+    int i, j;
+
+    nprobe= 0;
+    for (i= 0; i < N_PRBSRC; i++)
+    {
+	probesrc[i]= 0;
+	for (j= 0; j < N_PRBRES; j++)
+	    probeseq_res[j][i]= 0;
+    }
+    lastn= lastnprobe= 0;
+}
+
+
 /* Return the fraction of probe sequences that have have ended in making
  * a guess (ie, have not found a contradiction or a solution).
  */
@@ -465,8 +499,6 @@ float probe_rate(void)
 {
     int i,n;
     float rate;
-    static long lastn= 0;
-    static long lastnprobe= 0;
 
     for (i= 0; i < N_PRBSRC; i++)
 	n+= probeseq_res[PRBRES_BEST][i];
@@ -55,11 +55,19 @@ void free_puzzle(Puzzle *puz)
     {
 	for (i= 0; i < puz->n[k]; i++)
 	{
-	    safefree(puz->clue[k][i].length);
-	    safefree(puz->clue[k][i].color);
+	    if (puz->clueblock == NULL)
+	    {
+		safefree(puz->clue[k][i].length);
+		safefree(puz->clue[k][i].color);
+	    }
+	    safefree(puz->clue[k][i].nfa);
 	}
 	safefree(puz->clue[k]);
     }
+    safefree(puz->clueblock);
+    safefree(puz->job);
+    safefree(puz->history);
+    safefree(puz->found);
 
     for (sl= puz->sol; sl != NULL; sl= nsl)
     {
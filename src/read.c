@@ -268,6 +268,7 @@ Puzzle *load_puzzle(int fmt, int index)
 	fail("Input format not recognized\n");
     }
 
+    pack_clues(puz);
     return puz;
 }
 
@@ -6,6 +6,10 @@ extern char *srcname;
 
 #define MAXBUF 1024
 
+/* Failure message for puzzles with too many rows or columns for line_t */
+#define TOOBIG "Puzzle is more than %d cells wide or high.\n" \
+    "Recompile with BIGLINES defined in config.h to solve it\n"
+
 /* Routines to read from the input */
 int sgetc(void);
 int sungetc(int c);
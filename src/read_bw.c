@@ -60,7 +60,8 @@ char *sread_nonstr()
 
 int read_bw_clues(Clue *clue, line_t nclue)
 {
-    line_t i, n;
+    line_t i;
+    int n;
 
     for (i= 0; i < nclue; i++)
     {
@@ -90,6 +91,7 @@ int read_bw_clues(Clue *clue, line_t nclue)
 		skiptoeol();
 		break;
 	    }
+	    if (n > MAXLINE) fail(TOOBIG, MAXLINE);
 	    clue[i].length[clue[i].n]= n;
 	    clue[i].color[clue[i].n]= 1;
 	    clue[i].n++;
@@ -137,6 +139,7 @@ Puzzle *init_bw_puzzle()
 
 void init_clues(Puzzle *puz, int nrow, int ncol)
 {
+    if (nrow > MAXLINE || ncol > MAXLINE) fail(TOOBIG, MAXLINE);
 
     /* Constuct top-level clue arrays */
     puz->n[D_ROW]= nrow;
@@ -280,11 +283,15 @@ Puzzle *load_non_puzzle()
 	}
 	else if (!strcmp(word, "width"))
 	{
-	    if ((puz->n[D_COL]= sread_pint(1)) <= 0) fail(badfmt);
+	    if ((n= sread_pint(1)) <= 0) fail(badfmt);
+	    if (n > MAXLINE) fail(TOOBIG, MAXLINE);
+	    puz->n[D_COL]= n;
 	}
 	else if (!strcmp(word, "height"))
 	{
-	    if ((puz->n[D_ROW]= sread_pint(1)) <= 0) fail(badfmt);
+	    if ((n= sread_pint(1)) <= 0) fail(badfmt);
+	    if (n > MAXLINE) fail(TOOBIG, MAXLINE);
+	    puz->n[D_ROW]= n;
 	}
 	else if (!strcmp(word, "rows") || !strcmp(word, "columns"))
 	{
@@ -293,6 +300,7 @@ Puzzle *load_non_puzzle()
 	    	fail(badfmt);
 	    else if (n > 0)
 	    {
+		if (n > MAXLINE) fail(TOOBIG, MAXLINE);
 	    	puz->n[d]= n;
 		skiptoeol();
 	    }
@@ -344,10 +352,10 @@ Puzzle *load_lp_puzzle()
 {
     Puzzle *puz= init_bw_puzzle();
     dir_t d;
-    line_t i, j, n, c;
+    int i, j, n, c;
     char *badfmt= "Input is not in LP format, as expected\n";
     char *word;
-    line_t nrow, ncol;
+    int nrow, ncol;
     Clue *clue;
 
     if ((word= sread_keyword()) == NULL) fail(badfmt);
@@ -372,7 +380,7 @@ Puzzle *load_lp_puzzle()
 	    d= D_COL;
 	    i= atoi(word+7);
 	}
-	if (i-- == 0) fail(badfmt);
+	if (i-- <= 0 || i >= puz->n[d]) fail(badfmt);
 
 	if ((word= sread_keyword()) == NULL) fail(badfmt);
 	/*
@@ -380,6 +388,7 @@ Puzzle *load_lp_puzzle()
 	    strcmp(word, "number_of_clusters:")) fail(badfmt);
 	*/
 	if ((n= sread_pint(1)) < 0) fail(badfmt);
+	if (n > MAXLINE) fail(TOOBIG, MAXLINE);
 
 	clue= puz->clue[d];
     	clue[i].n= n;
@@ -403,6 +412,7 @@ Puzzle *load_lp_puzzle()
 	for (j= 0; j < n; j++)
 	{
 	    if ((c= sread_pint(1)) < 0) fail(badfmt);
+	    if (c > MAXLINE) fail(TOOBIG, MAXLINE);
 	    clue[i].length[j]= c;
 	    clue[i].color[j]= 1;
 	}
@@ -117,7 +117,9 @@ Puzzle *load_pbm_puzzle()
     if (ncol <= 0) fail("load_pbm: Could not read width\n");
 
     nrow= sread_pint(0);
-    if (ncol <= 0) fail("load_pbm: Could not read height\n");
+    if (nrow <= 0) fail("load_pbm: Could not read height\n");
+
+    if (nrow > MAXLINE || ncol > MAXLINE) fail(TOOBIG, MAXLINE);
 
     puz= init_bw_puzzle();
 
@@ -33,7 +33,7 @@ Puzzle *load_g_puzzle()
     ColorDef *c;
     Clue *clue;
     dir_t dir;
-    line_t i, n, sclue;
+    int i, n, sclue;
 
     puz->type= PT_GRID;
     puz->nset= 2;
@@ -178,6 +178,7 @@ Puzzle *load_g_puzzle()
 		}
 		if (n == 0)
 		    fail("Zero clue in input file\n");
+		if (n > MAXLINE) fail(TOOBIG, MAXLINE);
 
 		/* Store the clue number and color */
 		clue->length[clue->n]= n;
@@ -191,6 +192,7 @@ Puzzle *load_g_puzzle()
 		   cluename(PT_GRID,dir),i);
 	    }
 
+	    if (i == MAXLINE) fail(TOOBIG, MAXLINE);
 	    i++;
 	}
 
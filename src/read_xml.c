@@ -27,7 +27,7 @@
 void measure_xml_solution(Puzzle *puz, Solution *sol, char *p)
 {
     int inrow, inbrace;
-    line_t r, c, c0;
+    int r, c, c0;
     char *q;
 
     if (puz->type == PT_TRID)
@@ -75,6 +75,7 @@ void measure_xml_solution(Puzzle *puz, Solution *sol, char *p)
     }
     if (inbrace) fail("Unclosed [ in solution image\n");
     if (inrow) fail("Last row of solution does not end with |\n");
+    if (r > MAXLINE || c > MAXLINE) fail(TOOBIG, MAXLINE);
 
     sol->n[D_ROW]= r;
     sol->n[D_COL]= c;
@@ -181,7 +182,7 @@ void parse_xml_clue(xmlNode *root, Puzzle *puz, Clue *clue)
 {
    xmlNode *node;
    char *val, *col;
-   int i;
+   int i, n;
 
     /* First, just count the children */
     clue->n= 0;
@@ -204,7 +205,8 @@ void parse_xml_clue(xmlNode *root, Puzzle *puz, Clue *clue)
 	    val= xmlNodeGetContent(node);
 	    if (val == NULL || !isdigit(val[0]))
 	    	fail("expected number in <count> tag on line %d\n",node->line);
-	    clue->length[i]= atoi(val);
+	    if ((n= atoi(val)) > MAXLINE) fail(TOOBIG, MAXLINE);
+	    clue->length[i]= n;
 
 	    col= xmlGetProp(node,"color");
 	    clue->color[i]= (col == NULL) ? 1 : find_or_add_color(puz, col);
@@ -221,15 +223,17 @@ void parse_xml_clues(xmlNode *root, Puzzle *puz, int k)
 {
     xmlNode *node;
     Clue *clues;
-    int i;
+    int i, n;
 
     /* First, just count the children */
-    puz->n[k]= 0;
+    n= 0;
     for (node= root->children; node != NULL; node= node->next)
     {
 	if (!strcasecmp(node->name,"line"))
-	    puz->n[k]++;
+	    n++;
     }
+    if (n > MAXLINE) fail(TOOBIG, MAXLINE);
+    puz->n[k]= n;
 
     /* Now allocate memory */
     puz->clue[k]= (Clue *)calloc(puz->n[k], sizeof(Clue));
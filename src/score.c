@@ -181,10 +181,10 @@ float cell_score_neighbor(Puzzle *puz, Solution *sol, line_t i, line_t j)
     int count= 4;
 
     /* Count number of solved neighbors or edges */
-    if (i == 0 || sol->line[0][i-1][j]->n == 1) count--;
-    if (i == sol->n[0]-1 || sol->line[0][i+1][j]->n == 1) count--;
-    if (j == 0 || sol->line[0][i][j-1]->n == 1) count--;
-    if (sol->line[0][i][j+1]==NULL || sol->line[0][i][j+1]->n == 1) count--;
+    if (i == 0 || grid_cell(sol,i-1,j)->n == 1) count--;
+    if (i == sol->n[0]-1 || grid_cell(sol,i+1,j)->n == 1) count--;
+    if (j == 0 || grid_cell(sol,i,j-1)->n == 1) count--;
+    if (j == sol->n[1]-1 || grid_cell(sol,i,j+1)->n == 1) count--;
 
     return count;
 }
@@ -265,25 +265,25 @@ color_t pick_color_contrast(Puzzle *puz, Solution *sol, Cell *cell)
 	    n= 0;
 	    if (i > 0)
 	    {
-		if (!may_be(sol->line[0][i-1][j], c)) n++;
+		if (!may_be(grid_cell(sol,i-1,j), c)) n++;
 	    }
 	    else if (c != 0) n++;
 
 	    if (i < sol->n[0]-2)
 	    {
-	    	if (!may_be(sol->line[0][i+1][j], c)) n++;
+	    	if (!may_be(grid_cell(sol,i+1,j), c)) n++;
 	    }
 	    else if (c != 0) n++;
 
 	    if (j > 0)
 	    {
-	    	if (!may_be(sol->line[0][i][j-1], c)) n++;
+	    	if (!may_be(grid_cell(sol,i,j-1), c)) n++;
 	    }
 	    else if (c != 0) n++;
 
 	    if (j < sol->n[1]-2)
 	    {
-	    	if (!may_be(sol->line[0][i][j+1], c)) n++;
+	    	if (!may_be(grid_cell(sol,i,j+1), c)) n++;
 	    }
 	    else if (c != 0) n++;
 
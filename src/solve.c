@@ -41,6 +41,7 @@ void guess_cell(Puzzle *puz, Solution *sol, Cell *cell, color_t c)
     /* Set just that one color */
     cell->n= 1;
     fbit_setonly(cell->bit,c);
+    cell_changed(puz, cell, h->bit);
     solved_a_cell(puz,cell, 1);
 
     /* Put all crossing lines onto the job list */
@@ -73,8 +74,7 @@ int line_solve(Puzzle *puz, Solution *sol, int contradicting)
 	if (contradicting && depth >= contradepth)
 	{
 	    /* At max depth we just check if the line is solvable */
-	    line_t *pos, *bcl;
-	    if (!left_solve(puz, sol, dir, i, 0, &pos, &bcl))
+	    if (line_feasible(puz, sol, dir, i, NULL, NULL))
 	    {
 		if ((VC&&VV) || WL(dir,i))
 		    printf("C: %s %d OK AT DEPTH %d\n",
@@ -23,7 +23,21 @@
  *
  *     testline puzzle.xml R 7 L
  *
- * We haven't used this for years.  It might be broken.
+ * It can also be used to benchmark the line solvers.  First record the lines
+ * that pbnsolve passes to the line solver while solving a puzzle, and then
+ * give the same puzzle and the recorded lines to testline with the -b flag:
+ *
+ *     pbnsolve -r -u puzzle.xml 2> lines.rec
+ *     testline -b puzzle.xml lines.rec [reps]
+ *
+ * Each line is loaded into the grid and given to each of the line solvers
+ * reps times (default 100).  The average time per line and lines per second
+ * are reported for each solver, broken down by line length.  The bit-parallel
+ * solvers are only timed on the two color lines without blots that they
+ * handle.  lro_solve is timed with the state machines on every line, and
+ * with the bit-parallel solvers (as selected by -aB) on the lines they
+ * handle.  "make bench-line" does all this for a few of the example
+ * puzzles.
  */
 
 char *version= "1.0";
@@ -39,13 +53,277 @@ int verb[NVERB];
 int http= 0;
 int mayprobe= 1, mergeprobe= 1;
 long nlines, probes, guesses, backtracks, merges;
-int cachelines= 0;
+int cachelines= 0, tablelines= 0;
+int cachemb= 0;
+int storelines= 0;
+int puzzleno= 0;
+int maysettle= 0, maytable= 0, maysegment= 0, maybitwise= 0;
+int recordlines= 0;
+long settle_runs, settle_cells;
+long prepass_runs, prepass_skips;
 int hintlog= 0, hintlogn= -1;
 int probing= 0;
 bit_type *probepad= NULL;
 int maylinesolve= 1;
 int count_colors= 0;
 
+/* Line solving engines timed by the benchmark */
+#define E_LEFT		0
+#define E_RIGHT		1
+#define E_LEFTBW	2
+#define E_RIGHTBW	3
+#define E_LROBW		4
+#define E_LROFSM	5
+#define E_CACHE		6
+#define E_FEAS		7
+#define NENGINE		8
+char *engine_name[NENGINE]= {"left_solve", "right_solve",
+			     "left_solve_bw", "right_solve_bw",
+			     "lro_solve(bw)", "lro_solve(fsm)",
+			     "line_cache", "feasible"};
+
+/* A recorded line state */
+typedef struct {
+    dir_t k;
+    line_t i;
+    bit_type *bit;	/* fbit_size words for each cell in the line */
+} Record;
+
+
+/* NOW - Return a monotonic clock reading in nanoseconds.
+ */
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* READ_RECORDS - Read the line states written by "pbnsolve -r" from the
+ * given file.  Lines of the file that aren't records are ignored.  Returns
+ * an array of records and sets *nrec to the number of them.
+ */
+
+Record *read_records(Puzzle *puz, char *filename, int *nrec)
+{
+    FILE *fp;
+    Record *rec= NULL;
+    int srec= 0;
+    char *buf, *p, *q;
+    size_t bufsize;
+    int k, i;
+    line_t j, ncell;
+    color_t z;
+
+    if ((fp= fopen(filename, "r")) == NULL)
+	fail("Cannot open %s\n", filename);
+
+    bufsize= 32 + 18 * fbit_size *
+	(puz->n[D_ROW] > puz->n[D_COL] ? puz->n[D_ROW] : puz->n[D_COL]);
+    buf= (char *)malloc(bufsize);
+
+    *nrec= 0;
+    while (fgets(buf, bufsize, fp) != NULL)
+    {
+	if (sscanf(buf, "R %d %d", &k, &i) != 2 ||
+		k < 0 || k >= puz->nset || i < 0 || i >= puz->n[k])
+	    continue;
+
+	if (*nrec >= srec)
+	{
+	    srec= srec ? 2*srec : 1024;
+	    rec= (Record *)realloc(rec, srec * sizeof(Record));
+	}
+	ncell= puz->clue[k][i].linelen;
+	rec[*nrec].k= k;
+	rec[*nrec].i= i;
+	rec[*nrec].bit= (bit_type *)malloc(ncell*fbit_size*sizeof(bit_type));
+
+	/* Skip the "R k i" */
+	p= buf + 1;
+	strtol(p, &p, 10);
+	strtol(p, &p, 10);
+	for (j= 0; j < ncell; j++)
+	{
+	    for (z= 0; z < fbit_size; z++)
+	    {
+		if (z > 0 && *p == ':') p++;
+		rec[*nrec].bit[j*fbit_size + z]= strtoul(p, &q, 16);
+		if (q == p)
+		    fail("Bad record for %s %d in %s\n",
+			    CLUENAME(puz->type,k), i, filename);
+		p= q;
+	    }
+	}
+	(*nrec)++;
+    }
+    fclose(fp);
+    free(buf);
+    return rec;
+}
+
+
+/* LOAD_RECORD - Set the cells of a line to the states given in a record.
+ */
+
+void load_record(Puzzle *puz, Solution *sol, Record *r)
+{
+    Cell **cell= sol->line[r->k][r->i];
+    line_t ncell= puz->clue[r->k][r->i].linelen;
+    line_t j;
+
+    for (j= 0; j < ncell; j++)
+    {
+	fbit_cpy(cell[j]->bit, r->bit + j*fbit_size);
+	count_cell(puz, cell[j]);
+    }
+    repack_lines();
+
+    /* The solver keeps the bitboard in step as cells change, so reload it
+     * here, where it won't be counted against the first solver timed.
+     */
+    if (bitboard) load_bitboard(puz, sol);
+}
+
+
+/* BENCH_LINES - Time each of the line solving engines on the recorded lines
+ * and print a report.  For the cache, each line is first run through the
+ * line solver once and stored, so we are timing cache hits.
+ */
+
+void bench_lines(char *puzfile, char *recfile, int reps)
+{
+    Puzzle *puz;
+    Solution *sol;
+    Record *rec;
+    Clue *clue;
+    int nrec, r, n, e, bw;
+    line_t len, maxlen;
+    line_t *pos, *bcl;
+    double t, *ns[NENGINE], tns;
+    long *cnt[NENGINE], tcnt;
+
+    puz= load_puzzle_file(puzfile, FF_UNKNOWN, 1);
+    fbit_init(puz->ncolor);
+    init_line(puz);
+    init_bitboard(puz);
+    sol= new_solution(puz);
+    clue_init(puz, sol);
+    cachelines= 1;
+    init_cache(puz);
+    init_check(puz);
+
+    rec= read_records(puz, recfile, &nrec);
+    if (nrec == 0)
+	fail("No line records found in %s\n", recfile);
+
+    maxlen= (puz->n[D_ROW] > puz->n[D_COL]) ? puz->n[D_ROW] : puz->n[D_COL];
+    for (e= 0; e < NENGINE; e++)
+    {
+	ns[e]= (double *)calloc(maxlen + 1, sizeof(double));
+	cnt[e]= (long *)calloc(maxlen + 1, sizeof(long));
+    }
+
+    for (r= 0; r < nrec; r++)
+    {
+	clue= &puz->clue[rec[r].k][rec[r].i];
+	len= clue->linelen;
+	load_record(puz, sol, rec+r);
+	maybitwise= 1;
+	bw= use_bw(clue);
+
+	t= now();
+	for (n= 0; n < reps; n++)
+	    left_solve(puz, sol, rec[r].k, rec[r].i, 0, &pos, &bcl);
+	ns[E_LEFT][len]+= now() - t;
+	cnt[E_LEFT][len]+= reps;
+
+	t= now();
+	for (n= 0; n < reps; n++)
+	    right_solve(puz, sol, rec[r].k, rec[r].i, 0, &pos, &bcl);
+	ns[E_RIGHT][len]+= now() - t;
+	cnt[E_RIGHT][len]+= reps;
+
+	/* The bit-parallel solvers need the line loaded into their masks
+	 * first, so we time that with them, as lro_solve() would.
+	 */
+	if (bw)
+	{
+	    t= now();
+	    for (n= 0; n < reps; n++)
+	    {
+		bw_load(puz, sol, rec[r].k, rec[r].i);
+		left_solve_bw(puz, sol, rec[r].k, rec[r].i, 0, &pos, &bcl);
+	    }
+	    ns[E_LEFTBW][len]+= now() - t;
+	    cnt[E_LEFTBW][len]+= reps;
+
+	    t= now();
+	    for (n= 0; n < reps; n++)
+	    {
+		bw_load(puz, sol, rec[r].k, rec[r].i);
+		right_solve_bw(puz, sol, rec[r].k, rec[r].i, 0, &pos, &bcl);
+	    }
+	    ns[E_RIGHTBW][len]+= now() - t;
+	    cnt[E_RIGHTBW][len]+= reps;
+	}
+
+	/* Time lro_solve() with the state machines, and with the
+	 * bit-parallel solvers if they can do this line.
+	 */
+	for (maybitwise= 0; maybitwise <= bw; maybitwise++)
+	{
+	    e= maybitwise ? E_LROBW : E_LROFSM;
+	    t= now();
+	    for (n= 0; n < reps; n++)
+	    {
+		clue->lbadb= clue->rbadb= -1;
+		lro_solve(puz, sol, rec[r].k, rec[r].i);
+	    }
+	    ns[e][len]+= now() - t;
+	    cnt[e][len]+= reps;
+	}
+	maybitwise= 0;
+
+	/* Prime the cache with this line state */
+	if (line_cache(puz, sol, rec[r].k, rec[r].i) == NULL)
+	    add_cache(puz, sol, rec[r].k, rec[r].i);
+	t= now();
+	for (n= 0; n < reps; n++)
+	    line_cache(puz, sol, rec[r].k, rec[r].i);
+	ns[E_CACHE][len]+= now() - t;
+	cnt[E_CACHE][len]+= reps;
+
+	t= now();
+	for (n= 0; n < reps; n++)
+	    line_feasible(puz, sol, rec[r].k, rec[r].i, NULL, NULL);
+	ns[E_FEAS][len]+= now() - t;
+	cnt[E_FEAS][len]+= reps;
+    }
+
+    printf("%s: %d lines, %d reps\n", puzfile, nrec, reps);
+    printf("%-14s %6s %10s %10s %12s\n",
+	    "engine", "length", "lines", "ns/line", "lines/sec");
+    for (e= 0; e < NENGINE; e++)
+    {
+	tns= 0; tcnt= 0;
+	for (len= 0; len <= maxlen; len++)
+	{
+	    if (cnt[e][len] == 0) continue;
+	    printf("%-14s %6d %10ld %10.1f %12.0f\n", engine_name[e], len,
+		cnt[e][len], ns[e][len]/cnt[e][len],
+		1e9*cnt[e][len]/ns[e][len]);
+	    tns+= ns[e][len];
+	    tcnt+= cnt[e][len];
+	}
+	if (tcnt == 0) continue;
+	printf("%-14s %6s %10ld %10.1f %12.0f\n", engine_name[e], "all",
+	    tcnt, tns/tcnt, 1e9*tcnt/tns);
+    }
+}
+
 
 int main(int argc, char **argv)
 {
@@ -58,9 +336,16 @@ int main(int argc, char **argv)
     int dump= 0;
     line_t *pos, *bcl;
 
+    if (argc >= 4 && argc <= 5 && !strcmp(argv[1], "-b"))
+    {
+	bench_lines(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : 100);
+	exit(0);
+    }
+
     if (argc != 5)
     {
     	printf("usage: %s <file> [R|C] <n> [L|R]\n", argv[0]);
+    	printf("       %s -b <file> <recordfile> [reps]\n", argv[0]);
 	exit(1);
     }
 
@@ -99,6 +384,10 @@ int main(int argc, char **argv)
 	sol= new_solution(puz);
     }
 
+    fbit_init(puz->ncolor);
+    init_line(puz);
+    clue_init(puz, sol);
+
     if (left)
     {
 	printf("LEFT SOLVING:\n");